@@ -0,0 +1,214 @@
+#ifndef OPTITRACKLIB_BENCH_HPP
+#define OPTITRACKLIB_BENCH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Shared harness of the benchmark programs: per-iteration timing, allocation and CPU accounting,
+// console table and JSON report (--json <file>). Include in exactly one translation unit per
+// program, it replaces the global operator new/delete to count allocations.
+
+namespace bench {
+    inline std::atomic<uint64_t> allocations{0};
+
+    // CPU time consumed by the calling thread, in seconds
+    inline double threadCpu()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+
+    struct Result {
+        std::string name;
+        std::string unit = "ns";
+        size_t iterations = 0;
+        double mean = 0, p50 = 0, p90 = 0, p99 = 0, max = 0;
+        double allocations = 0; // per iteration
+        double cpu = 0; // ns per iteration, calling thread
+        std::vector<std::pair<std::string, double>> extras;
+
+        Result& extra(const std::string& key, double value)
+        {
+            extras.emplace_back(key, value);
+            return *this;
+        }
+    };
+
+    // Summary of raw samples; sorts them in place
+    inline Result summarize(const std::string& name, std::vector<double>& samples)
+    {
+        Result result;
+        result.name = name;
+        result.iterations = samples.size();
+        if (samples.empty())
+            return result;
+
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&](double p) { return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))]; };
+
+        double sum = 0;
+        for (double sample : samples)
+            sum += sample;
+
+        result.mean = sum / samples.size();
+        result.p50 = percentile(0.50);
+        result.p90 = percentile(0.90);
+        result.p99 = percentile(0.99);
+        result.max = samples.back();
+        return result;
+    }
+
+    class Suite {
+    public:
+        Suite(const std::string& name, int argc, char const* argv[]) : _name(name)
+        {
+            for (int i = 1; i < argc; i++) {
+                std::string arg = argv[i];
+                if (arg.rfind("--", 0) == 0 && i + 1 < argc)
+                    _options.emplace_back(arg.substr(2), argv[++i]);
+            }
+            _json = option("json", "");
+        }
+
+        ~Suite() { write(); }
+
+        // "--name value" argument, or fallback
+        std::string option(const std::string& name, const std::string& fallback) const
+        {
+            for (const auto& option : _options)
+                if (option.first == name)
+                    return option.second;
+            return fallback;
+        }
+
+        double option(const std::string& name, double fallback) const
+        {
+            std::string value = option(name, std::string());
+            return value.empty() ? fallback : std::atof(value.c_str());
+        }
+
+        // Comma separated list, e.g. "--bodies 10,50,200"
+        std::vector<double> values(const std::string& name, const std::string& fallback) const
+        {
+            std::vector<double> values;
+            std::stringstream stream(option(name, fallback));
+            for (std::string item; std::getline(stream, item, ',');)
+                values.push_back(std::atof(item.c_str()));
+            return values;
+        }
+
+        // Time samples x batch calls of fn; each sample is the mean of one batch, so that calls
+        // shorter than the clock overhead can be measured
+        template <typename Fn>
+        Result& measure(const std::string& name, size_t samples, size_t batch, Fn&& fn)
+        {
+            for (size_t i = 0; i < std::max<size_t>(samples / 10, 1); i++)
+                fn();
+
+            std::vector<double> times(samples);
+            uint64_t allocated = allocations.load();
+            double cpu = threadCpu();
+
+            for (size_t i = 0; i < samples; i++) {
+                auto start = std::chrono::steady_clock::now();
+                for (size_t j = 0; j < batch; j++)
+                    fn();
+                times[i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / batch;
+            }
+
+            double calls = double(samples) * batch;
+            cpu = (threadCpu() - cpu) * 1e9 / calls;
+            allocated = allocations.load() - allocated;
+
+            Result result = summarize(name, times);
+            result.iterations = static_cast<size_t>(calls);
+            result.allocations = allocated / calls;
+            result.cpu = cpu;
+            return record(result);
+        }
+
+        Result& record(const Result& result)
+        {
+            if (_results.empty())
+                printf("%s\n%-40s %10s %10s %10s %10s %10s %8s %10s\n", _name.c_str(), "", "mean", "p50", "p90", "p99", "max", "allocs", "cpu");
+
+            printf("%-40s %10.1f %10.1f %10.1f %10.1f %10.1f %8.2f %10.1f  %s\n", result.name.c_str(), result.mean, result.p50, result.p90, result.p99, result.max, result.allocations, result.cpu, result.unit.c_str());
+
+            _results.push_back(result);
+            return _results.back();
+        }
+
+        // Print the extras added to the last result since it was recorded
+        void annotate() const
+        {
+            if (_results.empty())
+                return;
+
+            for (const auto& extra : _results.back().extras)
+                printf("%42s%s = %g\n", "", extra.first.c_str(), extra.second);
+        }
+
+    protected:
+        std::string _name, _json;
+        std::vector<std::pair<std::string, std::string>> _options;
+        std::vector<Result> _results;
+
+        void write() const
+        {
+            if (_json.empty())
+                return;
+
+            FILE* file = std::fopen(_json.c_str(), "w");
+            if (!file) {
+                printf("Unable to write %s\n", _json.c_str());
+                return;
+            }
+
+            std::fprintf(file, "{\n  \"suite\": \"%s\",\n  \"results\": [", _name.c_str());
+            for (size_t i = 0; i < _results.size(); i++) {
+                const Result& r = _results[i];
+                std::fprintf(file, "%s\n    {\"name\": \"%s\", \"unit\": \"%s\", \"iterations\": %zu, \"mean\": %.6g, \"p50\": %.6g, \"p90\": %.6g, \"p99\": %.6g, \"max\": %.6g, \"allocations\": %.6g, \"cpu\": %.6g",
+                    i ? "," : "", r.name.c_str(), r.unit.c_str(), r.iterations, r.mean, r.p50, r.p90, r.p99, r.max, r.allocations, r.cpu);
+                for (const auto& extra : r.extras)
+                    std::fprintf(file, ", \"%s\": %.6g", extra.first.c_str(), extra.second);
+                std::fprintf(file, "}");
+            }
+            std::fprintf(file, "\n  ]\n}\n");
+            std::fclose(file);
+        }
+    };
+} // namespace bench
+
+void* operator new(std::size_t size)
+{
+    bench::allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+// GCC cannot see that the replaced new above is malloc
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // OPTITRACKLIB_BENCH_HPP
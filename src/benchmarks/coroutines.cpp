@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Bench.hpp"
+
+#include <optitrack_lib/Optitrack.hpp>
+#include <optitrack_lib/SyntheticSource.hpp>
+
+using namespace optitrack_lib;
+
+// Wake-up latency of a frame consumer, from the NatNet callback (the synthetic source thread) to the
+// consumer running: a thread blocked in waitForFrame(), and a coroutine suspended in co_await
+// nextFrame() resumed inline on the callback thread or posted to an EventLoop thread. C++20.
+// Options: --bodies N --rate Hz --seconds S --json <file>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Consumer {
+        std::atomic<int64_t> callback{0}; // ns, set before each injectFrame()
+        std::atomic<bool> stopping{false}, finished{false};
+        std::vector<double> latencies;
+
+        void record()
+        {
+            if (latencies.size() < latencies.capacity())
+                latencies.push_back(static_cast<double>(Clock::now().time_since_epoch().count() - callback.load(std::memory_order_acquire)));
+        }
+    };
+
+    Task consume(Optitrack& client, Consumer& consumer)
+    {
+        while (!consumer.stopping) {
+            co_await client.nextFrame();
+            consumer.record();
+            client.updateData();
+        }
+        consumer.finished.store(true, std::memory_order_release);
+    }
+
+    // mode: 0 = waitForFrame thread, 1 = inline executor, 2 = EventLoop thread
+    void run(bench::Suite& suite, const std::string& name, int mode, const SyntheticOptions& options, double seconds)
+    {
+        Optitrack client;
+        SyntheticSource source(options);
+        client.injectDescriptions(source.descriptions());
+
+        Consumer consumer;
+        consumer.latencies.reserve(static_cast<size_t>(seconds * options.rate * 2));
+
+        EventLoop loop;
+        std::thread thread;
+        if (mode == 0)
+            thread = std::thread([&]() {
+                while (!consumer.stopping)
+                    if (client.waitForFrame(std::chrono::milliseconds(100))) {
+                        consumer.record();
+                        client.updateData();
+                    }
+                consumer.finished = true;
+            });
+        else {
+            if (mode == 2) {
+                client.setExecutor(loop.executor());
+                thread = std::thread([&]() { loop.run(); });
+            }
+            consume(client, consumer);
+        }
+
+        uint64_t allocated = bench::allocations.load();
+        source.start([&](sFrameOfMocapData* frame) {
+            consumer.callback.store(Clock::now().time_since_epoch().count(), std::memory_order_release);
+            client.injectFrame(frame);
+        });
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+
+        // The coroutine returns on its next frame, so the source keeps running until then
+        consumer.stopping = true;
+        while (!consumer.finished.load(std::memory_order_acquire))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        source.stop();
+        loop.stop();
+        if (thread.joinable())
+            thread.join();
+
+        bench::Result result = bench::summarize(name, consumer.latencies);
+        result.allocations = (bench::allocations.load() - allocated) / std::max(static_cast<double>(source.delivered()), 1.0);
+        result.extra("frames", static_cast<double>(source.delivered()));
+        suite.record(result);
+        suite.annotate();
+    }
+} // namespace
+
+int main(int argc, char const* argv[])
+{
+    bench::Suite suite("coroutines", argc, argv);
+
+    SyntheticOptions options;
+    options.bodies = static_cast<int>(suite.option("bodies", 10.0));
+    options.rate = suite.option("rate", 240.0);
+    double seconds = suite.option("seconds", 2.0);
+
+    run(suite, "waitForFrame thread", 0, options, seconds);
+    run(suite, "co_await nextFrame, inline", 1, options, seconds);
+    run(suite, "co_await nextFrame, EventLoop thread", 2, options, seconds);
+
+    return 0;
+}
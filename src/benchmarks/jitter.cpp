@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Bench.hpp"
+
+#include <optitrack_lib/Optitrack.hpp>
+#include <optitrack_lib/SyntheticSource.hpp>
+
+using namespace optitrack_lib;
+
+// Frame pacing as seen by a consumer, from a synthetic source with injected delivery jitter and
+// reordering, without and with the jitter buffer at several target quantiles. The result is the
+// deviation of the consumer's frame intervals from the exposure intervals (ns); extras are the
+// resulting relative error of a finite-difference velocity, the latency added after arrival and the buffer
+// counters.
+// Options: --bodies N --rate Hz --jitter S --reorder P --seconds S --quantiles 0.9,0.99 --json <file>
+
+namespace {
+    struct Consumed {
+        int32_t frame;
+        double time; // consumption, steady_clock seconds
+        double latency; // consumption - arrival in the callback, seconds
+    };
+
+    void run(bench::Suite& suite, const std::string& name, const SyntheticOptions& options, double seconds, const JitterBufferOptions* buffer)
+    {
+        Optitrack client;
+        SyntheticSource source(options);
+        client.injectDescriptions(source.descriptions());
+        if (buffer)
+            client.enableJitterBuffer(*buffer);
+
+        std::vector<Consumed> consumed;
+        consumed.reserve(static_cast<size_t>(seconds * options.rate * 2));
+        std::atomic<bool> running{true};
+        std::thread consumer([&, reader = client.reader(ReadMode::Lossless)]() mutable {
+            while (running)
+                if (reader.wait(std::chrono::milliseconds(100)))
+                    reader.poll([&](const MocapFrame& frame) {
+                        auto now = std::chrono::steady_clock::now();
+                        if (consumed.size() < consumed.capacity())
+                            consumed.push_back({frame.iFrame, Optitrack::toSeconds(now), std::chrono::duration<double>(now - frame.receivedAt).count()});
+                    });
+        });
+
+        uint64_t allocated = bench::allocations.load();
+        source.start([&](sFrameOfMocapData* frame) { client.injectFrame(frame); });
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        source.stop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        running = false;
+        consumer.join();
+
+        // Intervals between consecutive frames against the exposure intervals
+        std::vector<double> deviations, velocity;
+        double latency = 0;
+        size_t outOfOrder = 0;
+        for (size_t i = 1; i < consumed.size(); i++) {
+            latency += consumed[i].latency;
+            int32_t frames = consumed[i].frame - consumed[i - 1].frame;
+            if (frames <= 0)
+                outOfOrder++;
+            if (frames != 1)
+                continue;
+
+            double interval = consumed[i].time - consumed[i - 1].time, exposure = 1.0 / options.rate;
+            deviations.push_back(std::abs(interval - exposure) * 1e9);
+            velocity.push_back(100 * std::abs(exposure / std::max(interval, 1e-6) - 1));
+        }
+        bench::Result velocityError = bench::summarize("velocity", velocity);
+
+        JitterBufferStats stats = client.jitterBufferStats();
+        bench::Result result = bench::summarize(name, deviations);
+        result.allocations = (bench::allocations.load() - allocated) / std::max(static_cast<double>(source.delivered()), 1.0);
+        result.extra("velocity error p50 (%)", velocityError.p50)
+            .extra("velocity error p90 (%)", velocityError.p90)
+            .extra("latency after arrival (ms)", 1e3 * latency / std::max<size_t>(consumed.size(), 1))
+            .extra("out of order", static_cast<double>(outOfOrder))
+            .extra("delay (ms)", 1e3 * stats.delay)
+            .extra("late", static_cast<double>(stats.late))
+            .extra("reordered", static_cast<double>(stats.reordered))
+            .extra("discarded", static_cast<double>(stats.discarded));
+        suite.record(result);
+        suite.annotate();
+    }
+} // namespace
+
+int main(int argc, char const* argv[])
+{
+    bench::Suite suite("jitter", argc, argv);
+
+    SyntheticOptions options;
+    options.bodies = static_cast<int>(suite.option("bodies", 10.0));
+    options.rate = suite.option("rate", 240.0);
+    options.jitter = suite.option("jitter", 0.002);
+    options.reorderProbability = suite.option("reorder", 0.01);
+    double seconds = suite.option("seconds", 5.0);
+
+    run(suite, "no buffer", options, seconds, nullptr);
+    for (double quantile : suite.values("quantiles", "0.9,0.99")) {
+        JitterBufferOptions buffer;
+        buffer.quantile = quantile;
+        run(suite, "jitter buffer q=" + std::to_string(quantile).substr(0, 4), options, seconds, &buffer);
+    }
+
+    printf("%.0f Hz, %.1f ms delivery jitter, %.1f%% reordered\n", options.rate, options.jitter * 1e3, options.reorderProbability * 100);
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Bench.hpp"
+
+#include <optitrack_lib/Optitrack.hpp>
+#include <optitrack_lib/SyntheticSource.hpp>
+
+using namespace optitrack_lib;
+
+// Full pipeline driven by a synthetic source: the source thread plays the NatNet callback thread and
+// a consumer thread runs waitForFrame() + updateData(). Latency is measured from the arrival of a
+// frame in the callback to the end of the updateData() call that publishes it. --readers adds lossless
+// frame readers on their own threads (recorders), which must not take frames from the consumer.
+// Options: --bodies 10,50,200 --rates 120,240,360,0 (0 = as fast as possible) --markers N --readers N
+//          --seconds S --jitter S --drop P --reorder P --json <file>
+
+template <typename Client>
+void run(bench::Suite& suite, const std::string& name, const SyntheticOptions& options, double seconds, int readerCount)
+{
+    Client client;
+    SyntheticSource source(options);
+    client.injectDescriptions(source.descriptions());
+
+    std::atomic<bool> reading{true};
+    std::vector<uint64_t> read(readerCount, 0);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < readerCount; r++)
+        readers.emplace_back([&, r, reader = client.reader(ReadMode::Lossless)]() mutable {
+            while (reading)
+                if (reader.wait(std::chrono::milliseconds(10)))
+                    read[r] += reader.poll([](const MocapFrame&) {});
+        });
+
+    // Ingest cost as seen by the callback thread
+    std::atomic<double> ingestCpu{0};
+    source.start([&](sFrameOfMocapData* frame) {
+        double cpu = bench::threadCpu();
+        client.injectFrame(frame);
+        ingestCpu.store(ingestCpu.load(std::memory_order_relaxed) + bench::threadCpu() - cpu, std::memory_order_relaxed);
+    });
+
+    std::vector<double> latencies;
+    latencies.reserve(static_cast<size_t>(seconds * (options.rate > 0 ? options.rate * 2 : 1e6)));
+    uint64_t allocated = bench::allocations.load(), delivered = source.delivered(), updates = 0;
+    double consumerCpu = bench::threadCpu();
+    auto start = std::chrono::steady_clock::now(), stop = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+
+    while (std::chrono::steady_clock::now() < stop) {
+        if (!client.waitForFrame(std::chrono::milliseconds(100)))
+            continue;
+
+        client.updateData();
+        updates++;
+        if (latencies.size() < latencies.capacity())
+            latencies.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - client.frameTime()).count());
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    consumerCpu = bench::threadCpu() - consumerCpu;
+    source.stop();
+    reading = false;
+    for (std::thread& reader : readers)
+        reader.join();
+
+    double frames = static_cast<double>(source.delivered() - delivered);
+    double total = std::max(frames, 1.0);
+
+    bench::Result result = bench::summarize(name + " " + std::to_string(options.bodies) + " bodies @ " + (options.rate > 0 ? std::to_string(int(options.rate)) + " Hz" : std::string("max")), latencies);
+    result.iterations = static_cast<size_t>(frames);
+    result.allocations = (bench::allocations.load() - allocated) / total;
+    result.cpu = (ingestCpu.load() + consumerCpu) * 1e9 / total;
+    result.extra("throughput", frames / elapsed)
+        .extra("updates", static_cast<double>(updates))
+        .extra("ingest_cpu_ns", ingestCpu.load() * 1e9 / total)
+        .extra("consumer_cpu_ns", consumerCpu * 1e9 / total)
+        .extra("dropped", static_cast<double>(source.dropped()))
+        .extra("reordered", static_cast<double>(source.reordered()));
+    if (readerCount)
+        result.extra("reader_missed", frames - static_cast<double>(*std::min_element(read.begin(), read.end())));
+    suite.record(result);
+    suite.annotate();
+}
+
+int main(int argc, char const* argv[])
+{
+    bench::Suite suite("macro", argc, argv);
+
+    SyntheticOptions options;
+    options.markers = static_cast<int>(suite.option("markers", 0.0));
+    options.jitter = suite.option("jitter", 0.0);
+    options.dropProbability = suite.option("drop", 0.0);
+    options.reorderProbability = suite.option("reorder", 0.0);
+    double seconds = suite.option("seconds", 2.0);
+    int readers = static_cast<int>(suite.option("readers", 0.0));
+
+    // Latency percentiles are end-to-end ns per frame; cpu and allocations are per delivered frame
+    for (double bodies : suite.values("bodies", "10,50,200"))
+        for (double rate : suite.values("rates", "120,240,360,0")) {
+            options.bodies = static_cast<int>(bodies);
+            options.rate = rate;
+            run<Optitrack>(suite, "generic", options, seconds, readers);
+            run<RigidBodyOptitrack>(suite, "rigid-body", options, seconds, readers);
+        }
+
+    return 0;
+}
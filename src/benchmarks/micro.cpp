@@ -0,0 +1,193 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+#include "Bench.hpp"
+
+#include <optitrack_lib/Optitrack.hpp>
+#include <optitrack_lib/PoseCodec.hpp>
+#include <optitrack_lib/SyntheticSource.hpp>
+
+using namespace optitrack_lib;
+
+// Microbenchmarks of the ingest path, the lookups and the per-frame kernels, no server needed.
+// Options: --bodies N --kernel-bodies N --markers N --samples N --json <file>
+
+// NatNet callback cost (copy of the ingested categories into the queue), then with updateData()
+template <typename Client>
+void ingest(bench::Suite& suite, const std::string& name, SyntheticSource& source, size_t samples)
+{
+    Client client;
+    client.injectDescriptions(source.descriptions());
+    sFrameOfMocapData* frame = source.next();
+
+    suite.measure("storeFrames " + name, samples, 1, [&]() {
+        frame->iFrame++;
+        client.injectFrame(frame);
+    });
+
+    suite.measure("storeFrames+updateData " + name, samples, 1, [&]() {
+        frame->iFrame++;
+        client.injectFrame(frame);
+        client.updateData();
+    });
+}
+
+int main(int argc, char const* argv[])
+{
+    bench::Suite suite("micro", argc, argv);
+
+    SyntheticOptions options;
+    options.bodies = static_cast<int>(suite.option("bodies", 50.0));
+    options.markers = static_cast<int>(suite.option("markers", 200.0));
+    size_t samples = static_cast<size_t>(suite.option("samples", 20000.0));
+
+    SyntheticSource source(options);
+
+    ingest<Optitrack>(suite, "generic", source, samples);
+    ingest<BasicOptitrack<Ingest<RigidBodies>, Precision<float>, GateOnly>>(suite, "rigid-body gated", source, samples);
+    ingest<RigidBodyOptitrack>(suite, "rigid-body", source, samples);
+
+    // Handle maps and table rebuild on new descriptions
+    Optitrack client;
+    suite.measure("description map rebuild", samples / 10, 1, [&]() { client.injectDescriptions(source.descriptions()); });
+
+    // Compact description model: build, perfect hash lookup and warm start from its file
+    std::shared_ptr<const DescriptionCache> descriptions;
+    suite.measure("DescriptionCache::build", samples / 10, 1, [&]() { descriptions = DescriptionCache::build(*source.descriptions(), 1); });
+    std::string cachePath = "/tmp/optitrack_micro.descriptions";
+    descriptions->save(cachePath);
+    suite.measure("DescriptionCache::open", samples / 10, 1, [&]() { descriptions = DescriptionCache::open(cachePath, 1); })
+        .extra("bytes", double(descriptions->bytes()));
+    suite.annotate();
+    std::remove(cachePath.c_str());
+
+    client.injectFrame(source.next());
+    client.updateData();
+
+    std::string last = "Body_" + std::to_string(options.bodies - 1);
+    int handle = client.handle(last), sink = 0;
+    Optitrack::Pose pose;
+
+    suite.measure("rigidBody(handle)", samples, 100, [&]() { pose = client.rigidBody(handle); });
+    suite.measure("rigidBody(name)", samples, 100, [&]() { pose = client.rigidBody(last); });
+    suite.measure("handle(name)", samples, 100, [&]() { sink += client.handle(last); });
+    suite.measure("DescriptionCache::find", samples, 100, [&]() { sink += descriptions->find(last); });
+
+    // Pose kernels over all bodies, fed with the synthetic trajectories of a larger scene (1000 bodies
+    // by default, --kernel-bodies)
+    SyntheticOptions kernels = options;
+    kernels.bodies = static_cast<int>(suite.option("kernel-bodies", 1000.0));
+    SyntheticSource kernelSource(kernels);
+    const int frames = 240;
+    std::vector<FilterBank::Poses> trajectory(frames, FilterBank::Poses(kernels.bodies, 7));
+    for (int k = 0; k < frames; k++) {
+        sFrameOfMocapData* data = kernelSource.next();
+        for (int i = 0; i < kernels.bodies; i++) {
+            const sRigidBodyData& body = data->RigidBodies[i];
+            trajectory[k].row(i) << body.x, body.y, body.z, body.qx, body.qy, body.qz, body.qw;
+        }
+    }
+
+    FilterBank::Mask tracked = FilterBank::Mask::Constant(kernels.bodies, true);
+    FilterBank::Array dt = FilterBank::Array::Constant(kernels.bodies, 1.0f / kernels.rate);
+    FilterBank::Array meanError = FilterBank::Array::Constant(kernels.bodies, 2e-4f);
+    int k = 0;
+
+    GateBank gate;
+    gate.resize(kernels.bodies);
+    suite.measure("GateBank::update", samples, 1, [&]() { gate.update(trajectory[k++ % frames], tracked, meanError, dt); });
+
+    const char* names[] = {"none", "one-euro", "kalman"};
+    FilterType types[] = {FilterType::None, FilterType::OneEuro, FilterType::Kalman};
+    for (int i = 0; i < 3; i++) {
+        FilterBank bank(types[i]);
+        suite.measure(std::string("FilterBank::update ") + names[i], samples, 1, [&]() { bank.update(trajectory[k++ % frames], tracked, dt); });
+    }
+
+    // Deadband test of one listener per body: bodies at rest (nothing fires) and moving (all fire)
+    ChangeBank resting, moving;
+    for (int i = 0; i < kernels.bodies; i++) {
+        resting.add(i, 1e3f, 3.0f);
+        moving.add(i, 0.0f, 0.0f);
+    }
+    suite.measure("ChangeBank::update resting", samples, 1, [&]() { sink += resting.update(trajectory[k++ % frames], tracked).size(); });
+    suite.measure("ChangeBank::update moving", samples, 1, [&]() { sink += moving.update(trajectory[k++ % frames], tracked).size(); });
+
+    // Relative poses of consecutive bodies: batch evaluation against one Eigen transform per pair
+    using Table = Eigen::Matrix<double, Eigen::Dynamic, 7, Eigen::RowMajor>;
+    std::vector<Table> tables(frames);
+    for (int f = 0; f < frames; f++)
+        tables[f] = trajectory[f].cast<double>().matrix();
+
+    RelativePoseBank<double> relative;
+    for (int i = 0; i + 1 < kernels.bodies; i++)
+        relative.add(i, i + 1);
+    suite.measure("RelativePoseBank::evaluate", samples, 1, [&]() {
+        const Table& table = tables[k++ % frames];
+        sink += relative.evaluate(RelativePoseBank<double>::Table(table.data(), table.rows(), 7))(0, 0) > 0;
+    });
+
+    std::vector<Eigen::Matrix<double, 7, 1>> pairs(kernels.bodies);
+    suite.measure("relative poses, per pair", samples, 1, [&]() {
+        const Table& table = tables[k++ % frames];
+        for (int i = 0; i + 1 < kernels.bodies; i++) {
+            Eigen::Quaterniond qa(table(i, 6), table(i, 3), table(i, 4), table(i, 5)), qb(table(i + 1, 6), table(i + 1, 3), table(i + 1, 4), table(i + 1, 5));
+            Eigen::Quaterniond inverse = qa.inverse();
+            pairs[i].head<3>() = inverse * (table.row(i + 1).head<3>() - table.row(i).head<3>()).transpose();
+            pairs[i].tail<4>() = (inverse * qb).coeffs();
+        }
+        sink += pairs[0](0) > 0;
+    });
+
+    // Fixed-rate resampling of all bodies from their history: 1 kHz ticks within the recorded frames
+    // (interpolated) and past the newest one (extrapolated)
+    PoseHistory history(frames);
+    for (int f = 0; f < frames; f++)
+        for (int i = 0; i < kernels.bodies; i++)
+            history.push(i, f / kernels.rate, tables[f].row(i));
+    Resampler resampler;
+    double span = (frames - 1) / kernels.rate;
+    suite.measure("Resampler::sample interpolated", samples, 1, [&]() { resampler.sample(history, kernels.bodies, (k++ % 1000) * 1e-3 * span); });
+    suite.measure("Resampler::sample extrapolated", samples, 1, [&]() { resampler.sample(history, kernels.bodies, span + (k++ % 10) * 1e-3); });
+    sink += resampler.count(SampleKind::Extrapolated);
+
+    // Pose codec on the same trajectories; every keyframeInterval-th packet is a keyframe
+    PoseEncoder encoder;
+    PoseDecoder decoder;
+    std::vector<Eigen::Array<double, Eigen::Dynamic, 7>> table(frames);
+    std::vector<std::vector<uint8_t>> packets(frames);
+    for (int f = 0; f < frames; f++)
+        table[f] = trajectory[f].cast<double>();
+
+    bench::Result& encode = suite.measure("PoseEncoder::encode", samples, 1, [&]() {
+        int f = k++ % frames;
+        packets[f] = encoder.encode(table[f]);
+    });
+
+    // Replay one pass in order, starting from a keyframe
+    encoder.forceKeyframe();
+    size_t bytes = 0;
+    for (int f = 0; f < frames; f++) {
+        packets[f] = encoder.encode(table[f]);
+        bytes += packets[f].size();
+    }
+    encode.extra("bytes/body", double(bytes) / frames / kernels.bodies);
+    suite.annotate();
+
+    k = 0;
+    suite.measure("PoseDecoder::decode", samples, 1, [&]() { sink += decoder.decode(packets[k++ % frames]); });
+
+#ifdef OPTITRACK_ENABLE_TRACING
+    // Cost of one recorded event (two clock reads and a ring write)
+    Tracer::instance().enable();
+    suite.measure("trace scope", samples, 100, [&]() { OPTITRACK_TRACE_SCOPE("bench", k); });
+    Tracer::instance().enable(false);
+#endif
+
+    printf("%d bodies (%d in the kernels), %d markers, checksum %d\n", options.bodies, kernels.bodies, options.markers, sink);
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+#include "Bench.hpp"
+
+#include <optitrack_lib/PoseCodec.hpp>
+
+using namespace optitrack_lib;
+
+// Packet size and encode/decode cost on bodies moving at walking speed, sampled at 240 Hz
+// Options: --bodies N --frames N --resolution M --json <file>
+int main(int argc, char const* argv[])
+{
+    bench::Suite suite("pose_codec", argc, argv);
+
+    int bodies = static_cast<int>(suite.option("bodies", 100.0));
+    int frames = static_cast<int>(suite.option("frames", 24000.0));
+    float resolution = static_cast<float>(suite.option("resolution", 1e-4));
+
+    const double dt = 1.0 / 240.0, speed = 1.5, angularSpeed = 2.0;
+
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<double> uniform(-3.0, 3.0);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    Eigen::Array<double, Eigen::Dynamic, 7> poses(bodies, 7);
+    Eigen::Array<double, Eigen::Dynamic, 3> velocity(bodies, 3), rate(bodies, 3);
+    for (int i = 0; i < bodies; i++) {
+        Eigen::Vector3d v(normal(generator), normal(generator), normal(generator)), w(normal(generator), normal(generator), normal(generator));
+        velocity.row(i) = (speed * v.normalized()).transpose().array();
+        rate.row(i) = (angularSpeed * w.normalized()).transpose().array();
+        poses.row(i) << uniform(generator), uniform(generator), uniform(generator), 0, 0, 0, 1;
+    }
+
+    CodecParams params;
+    params.resolution = resolution;
+    PoseEncoder encoder(params);
+    PoseDecoder decoder;
+
+    std::vector<double> encodeNs(frames), decodeNs(frames);
+    double positionError = 0, angleError = 0;
+    size_t keyframeBytes = 0, deltaBytes = 0, keyframes = 0, failures = 0;
+
+    for (int frame = 0; frame < frames; frame++) {
+        for (int i = 0; i < bodies; i++) {
+            // Bounce within a 6 m room
+            poses.row(i).head<3>() += velocity.row(i) * dt;
+            velocity.row(i) = (poses.row(i).head<3>().abs() > 3.0 && poses.row(i).head<3>() * velocity.row(i) > 0).select(-velocity.row(i), velocity.row(i));
+            Eigen::Quaterniond q(poses(i, 6), poses(i, 3), poses(i, 4), poses(i, 5));
+            Eigen::Vector3d w = rate.row(i).transpose().matrix();
+            q = (q * Eigen::Quaterniond(Eigen::AngleAxisd(w.norm() * dt, w.normalized()))).normalized();
+            poses.row(i).tail<4>() << q.x(), q.y(), q.z(), q.w();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        const std::vector<uint8_t>& packet = encoder.encode(poses);
+        auto encoded = std::chrono::steady_clock::now();
+        failures += !decoder.decode(packet);
+        auto decoded = std::chrono::steady_clock::now();
+
+        encodeNs[frame] = std::chrono::duration<double, std::nano>(encoded - start).count() / bodies;
+        decodeNs[frame] = std::chrono::duration<double, std::nano>(decoded - encoded).count() / bodies;
+
+        if (packet[1] & codec::kKeyframe) {
+            keyframeBytes += packet.size();
+            keyframes++;
+        }
+        else
+            deltaBytes += packet.size();
+
+        positionError = std::max(positionError, (decoder.poses().leftCols<3>() - poses.leftCols<3>()).abs().maxCoeff());
+        Eigen::Array<double, Eigen::Dynamic, 1> dot = (decoder.poses().rightCols<4>() * poses.rightCols<4>()).rowwise().sum().abs().min(1.0);
+        angleError = std::max(angleError, (2 * dot.acos()).maxCoeff());
+    }
+
+    size_t deltas = frames - keyframes;
+    printf("Pose codec, %d bodies, %d frames at 240 Hz, resolution %g m, keyframe every %u, ns/body\n", bodies, frames, resolution, params.keyframeInterval);
+
+    suite.record(bench::summarize("encode", encodeNs))
+        .extra("keyframe_bytes_per_body", double(keyframeBytes) / keyframes / bodies)
+        .extra("delta_bytes_per_body", deltas ? double(deltaBytes) / deltas / bodies : 0.0)
+        .extra("average_bytes_per_body", double(keyframeBytes + deltaBytes) / frames / bodies)
+        .extra("raw_bytes_per_body", 56.0);
+    suite.annotate();
+
+    suite.record(bench::summarize("decode", decodeNs))
+        .extra("max_position_error", positionError)
+        .extra("max_angle_error", angleError)
+        .extra("failures", static_cast<double>(failures));
+    suite.annotate();
+
+    return 0;
+}
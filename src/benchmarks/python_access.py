@@ -0,0 +1,80 @@
+#!/usr/bin/env python
+# encoding: utf-8
+#
+#    This file is part of optitrack-lib.
+#
+#    Copyright (c) 2023 Bernardo Fichera <bernardo.fichera@gmail.com>
+#
+#    Permission is hereby granted, free of charge, to any person obtaining a copy
+#    of this software and associated documentation files (the "Software"), to deal
+#    in the Software without restriction, including without limitation the rights
+#    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+#    copies of the Software, and to permit persons to whom the Software is
+#    furnished to do so, subject to the following conditions:
+#
+#    The above copyright notice and this permission notice shall be included in all
+#    copies or substantial portions of the Software.
+#
+#    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+#    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+#    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+#    SOFTWARE.
+
+# Per-frame cost of reading poses from Python: native module versus the ZMQ
+# subscriber fed by publish_zmq. Costs are CPU time of the reading thread, so
+# the time spent blocked waiting for the next frame is not counted.
+#
+#   python python_access.py [frames] [body]     (publish_zmq running for the ZMQ path)
+
+import sys
+import time
+
+import numpy as np
+
+import optitrack_lib
+
+frames = int(sys.argv[1]) if len(sys.argv) > 1 else 2000
+body = sys.argv[2] if len(sys.argv) > 2 else "Obstacle_stick"
+
+
+def native():
+    opt = optitrack_lib.Optitrack()
+    opt.connect()
+    opt.update_data_descriptions()
+    handle = opt.handle(body)
+
+    cpu, poses = 0.0, None
+    for _ in range(frames):
+        opt.wait_for_frame(1.0)
+        start = time.thread_time()
+        opt.update_data()
+        poses = opt.poses()
+        pose = poses[handle]
+        cpu += time.thread_time() - start
+
+    # The view is refreshed in place, no copy per frame
+    assert poses.base is not None
+    return cpu / frames
+
+
+def zmq():
+    from zmq_stream.subscriber import Subscriber
+
+    sub = Subscriber()
+    sub.configure("localhost", "5511")
+
+    cpu = 0.0
+    for _ in range(frames):
+        start = time.thread_time()
+        pose = sub.receive(np.float64, 7)
+        cpu += time.thread_time() - start
+
+    return cpu / frames
+
+
+print("%-10s %12s" % ("path", "us/frame"))
+print("%-10s %12.2f" % ("native", native() * 1e6))
+print("%-10s %12.2f" % ("zmq", zmq() * 1e6))
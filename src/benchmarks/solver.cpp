@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+#include "Bench.hpp"
+
+#include <optitrack_lib/Optitrack.hpp>
+#include <optitrack_lib/SyntheticSource.hpp>
+
+using namespace optitrack_lib;
+
+// Client-side rigid-body solving from the labeled markers of the synthetic bodies, with marker noise,
+// outliers and occlusions, alone and through the client (addSolvedBody, gate and filter included).
+// Target: below the 2.78 ms frame period at 360 Hz with 50 bodies of 6 markers.
+// Options: --bodies N --markers N (per body) --noise m --outliers p --occlusions p --samples N --json <file>
+int main(int argc, char const* argv[])
+{
+    bench::Suite suite("solver", argc, argv);
+
+    SyntheticOptions options;
+    options.bodies = static_cast<int>(suite.option("bodies", 50.0));
+    options.markers = options.bodies * static_cast<int>(suite.option("markers", 6.0));
+    options.markerNoise = suite.option("noise", 3e-4);
+    options.markerOutlierProbability = suite.option("outliers", 0.01);
+    double occlusions = suite.option("occlusions", 0.02);
+    size_t samples = static_cast<size_t>(suite.option("samples", 5000.0));
+
+    // One second of frames, with occluded markers flagged as Motive does
+    SyntheticSource source(options);
+    const int frames = 240;
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<std::vector<sMarker>> markers(frames);
+    std::vector<std::vector<sRigidBodyData>> truth(frames);
+    for (int k = 0; k < frames; k++) {
+        sFrameOfMocapData* data = source.next();
+        markers[k].assign(data->LabeledMarkers, data->LabeledMarkers + data->nLabeledMarkers);
+        truth[k].assign(data->RigidBodies, data->RigidBodies + data->nRigidBodies);
+        for (sMarker& marker : markers[k])
+            if (uniform(generator) < occlusions)
+                marker.params |= 0x01;
+    }
+
+    MarkerSolver solver;
+    sDataDescriptions* descriptions = source.descriptions();
+    for (int i = 0; i < descriptions->nDataDescriptions; i++)
+        solver.add(MarkerTemplate::fromDescription(*descriptions->arrDataDescriptions[i].Data.RigidBodyDescription));
+
+    // Accuracy and rejections over the recorded frames
+    double position = 0, angle = 0;
+    uint64_t rejected = 0, invalid = 0;
+    for (int k = 0; k < frames; k++) {
+        const MarkerSolver::Poses& poses = solver.solve(markers[k]);
+        for (int i = 0; i < options.bodies; i++) {
+            const sRigidBodyData& body = truth[k][i];
+            Eigen::Quaterniond q(poses(i, 6), poses(i, 3), poses(i, 4), poses(i, 5)), expected(body.qw, body.qx, body.qy, body.qz);
+            position += (poses.row(i).head<3>().matrix() - Eigen::Vector3d(body.x, body.y, body.z).transpose()).norm();
+            angle += q.angularDistance(expected);
+            rejected += solver.stats(i).rejected;
+            invalid += !solver.stats(i).valid;
+        }
+    }
+    double solves = double(frames) * options.bodies;
+
+    int k = 0;
+    bench::Result& result = suite.measure("MarkerSolver::solve", samples, 1, [&]() { solver.solve(markers[k++ % frames]); });
+    result.extra("mean position error (mm)", 1e3 * position / solves)
+        .extra("mean angle error (deg)", angle / solves * 180 / M_PI)
+        .extra("rejected/frame", rejected / double(frames))
+        .extra("invalid/frame", invalid / double(frames));
+    suite.annotate();
+
+    // Same frames through the client: ingest, solve, gate and filter in updateData()
+    Optitrack client;
+    client.injectDescriptions(descriptions);
+    for (int i = 0; i < descriptions->nDataDescriptions; i++) {
+        const sRigidBodyDescription& description = *descriptions->arrDataDescriptions[i].Data.RigidBodyDescription;
+        client.addSolvedBody(MarkerTemplate::fromDescription(description, std::string(description.szName) + "_solved"));
+    }
+
+    sFrameOfMocapData* frame = source.next();
+    suite.measure("injectFrame+updateData with solved bodies", samples, 1, [&]() {
+        const std::vector<sMarker>& labeled = markers[k++ % frames];
+        std::copy(labeled.begin(), labeled.end(), frame->LabeledMarkers);
+        frame->iFrame++;
+        client.injectFrame(frame);
+        client.updateData();
+    });
+
+    printf("%d bodies, %d markers per frame, budget 2778 us at 360 Hz\n", options.bodies, options.markers);
+    return 0;
+}
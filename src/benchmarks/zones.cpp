@@ -0,0 +1,82 @@
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+
+#include <optitrack_lib/Optitrack.hpp>
+#include <optitrack_lib/SyntheticSource.hpp>
+
+using namespace optitrack_lib;
+
+// Zone engine per frame over the synthetic trajectories: world boxes on a grid and capsules and
+// spheres attached to bodies, each with an "any body" rule, against the exhaustive test of every body
+// against every zone. Target: below 100 us per frame with 200 bodies and 100 zones.
+// Options: --bodies N --zones N --samples N --json <file>
+int main(int argc, char const* argv[])
+{
+    bench::Suite suite("zones", argc, argv);
+
+    SyntheticOptions options;
+    options.bodies = static_cast<int>(suite.option("bodies", 200.0));
+    int zones = static_cast<int>(suite.option("zones", 100.0));
+    size_t samples = static_cast<size_t>(suite.option("samples", 5000.0));
+
+    // Pose tables of one second of frames
+    SyntheticSource source(options);
+    const int frames = 240;
+    std::vector<Eigen::Matrix<double, Eigen::Dynamic, 7, Eigen::RowMajor>> tables(frames);
+    for (int k = 0; k < frames; k++) {
+        sFrameOfMocapData* data = source.next();
+        tables[k].resize(options.bodies, 7);
+        for (int i = 0; i < options.bodies; i++) {
+            const sRigidBodyData& body = data->RigidBodies[i];
+            tables[k].row(i) << body.x, body.y, body.z, body.qx, body.qy, body.qz, body.qw;
+        }
+    }
+    Eigen::Array<bool, Eigen::Dynamic, 1> updated = Eigen::Array<bool, Eigen::Dynamic, 1>::Constant(options.bodies, true);
+
+    // Bodies span about 3.5 x 2 x 0.4 m
+    ZoneEngine engine;
+    for (int z = 0; z < zones; z++) {
+        Zone zone;
+        if (z % 5 < 3) {
+            zone = Zone::box(Eigen::Vector3d(0.1, 0.1, 0.3));
+            zone.offset = Eigen::Vector3d(-0.5 + 0.25 * (z % 16), -0.5 + 0.25 * (z / 16), 1.0);
+        }
+        else if (z % 5 == 3)
+            zone = Zone::capsule(0.15, 0.05, z % options.bodies);
+        else
+            zone = Zone::sphere(0.1, z % options.bodies);
+
+        ZoneRule rule;
+        rule.zone = engine.addZone(zone);
+        rule.distance = z % 2 ? 0.05 : 0.0;
+        engine.addRule(rule);
+    }
+
+    int k = 0;
+    uint64_t events = 0;
+    ZoneEvent event;
+    bench::Result& result = suite.measure("ZoneEngine::update", samples, 1, [&]() {
+        engine.update(tables[k % frames], updated, k, std::chrono::steady_clock::time_point());
+        k++;
+        while (engine.poll(event))
+            events++;
+    });
+    result.extra("events/frame", double(events) / k).extra("rebuilds", double(engine.rebuilds()));
+    suite.annotate();
+
+    // The same rules without the hierarchy: every body against every zone
+    double sink = 0;
+    suite.measure("exhaustive signed distances", samples / 10, 1, [&]() {
+        const auto& table = tables[k++ % frames];
+        for (int b = 0; b < options.bodies; b++) {
+            Eigen::Vector3d point = table.row(b).head<3>().transpose();
+            for (int z = 0; z < zones; z++)
+                sink += engine.distance(z, point) < 0;
+        }
+    });
+
+    printf("%d bodies, %d zones, checksum %g\n", options.bodies, zones, sink);
+    return 0;
+}
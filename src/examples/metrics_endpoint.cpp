@@ -0,0 +1,27 @@
+#include <iostream>
+#include <optitrack_lib/MetricsServer.hpp>
+#include <optitrack_lib/Optitrack.hpp>
+
+using namespace optitrack_lib;
+
+// Receive frames and expose the client health for Prometheus:
+//   curl http://<host>:9464/metrics
+int main(int argc, char const* argv[])
+{
+    Optitrack opt;
+
+    MetricsEndpoint endpoint;
+    endpoint.address = "0.0.0.0";
+    MetricsServer server(opt.metrics(), endpoint);
+
+    opt.enableWatchdog();
+    opt.connect(argc > 1 ? argv[1] : "");
+    opt.updateDataDescriptions();
+
+    while (true) {
+        if (opt.waitForFrame(std::chrono::milliseconds(100)))
+            opt.updateData();
+    }
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include <Eigen/Core>
+#include <iostream>
+
+#include <optitrack_lib/Optitrack.hpp>
+#include <optitrack_lib/PoseCodec.hpp>
+#include <zmq_stream/Publisher.hpp>
+
+using namespace zmq_stream;
+using namespace optitrack_lib;
+
+// Publishes the whole pose table, compressed (see PoseCodec.hpp), once per frame
+int main(int argc, char const* argv[])
+{
+    Publisher publisher;
+    publisher.configure("0.0.0.0", "5511");
+
+    Optitrack optitrack;
+    optitrack.connect();
+    optitrack.updateDataDescriptions();
+
+#ifdef OPTITRACK_ENABLE_TRACING
+    // Built with --tracing: write a trace whenever frames arrive more than 10 ms apart
+    TraceTrigger trigger;
+    trigger.frameIntervalMillisec = 10;
+    Tracer::instance().enable();
+    Tracer::instance().arm(trigger);
+#endif
+
+    CodecParams params;
+    params.resolution = argc > 1 ? std::atof(argv[1]) : 1e-4f;
+    PoseEncoder encoder(params);
+
+    while (true)
+    {
+        if (!optitrack.waitForFrame(std::chrono::milliseconds(100)))
+            continue;
+
+        optitrack.updateData();
+
+        OPTITRACK_TRACE_SCOPE("publish");
+        const std::vector<uint8_t>& packet = encoder.encode(optitrack.poses());
+        publisher.publish(Eigen::Map<const Eigen::Matrix<uint8_t, Eigen::Dynamic, 1>>(packet.data(), packet.size()).eval());
+    }
+
+    return 0;
+}
@@ -21,6 +21,8 @@ int main(int argc, char const* argv[])
     {
         optitrack.updateDataDescriptions();
         optitrack.updateData();
+
+        OPTITRACK_TRACE_SCOPE("publish");
         publisher.publish(optitrack.rigidBody("Obstacle_stick"));
     }
 
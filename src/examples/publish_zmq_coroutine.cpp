@@ -0,0 +1,44 @@
+#include <Eigen/Core>
+#include <iostream>
+
+#include <optitrack_lib/Optitrack.hpp>
+#include <zmq_stream/Publisher.hpp>
+
+using namespace zmq_stream;
+using namespace optitrack_lib;
+
+// publish_zmq as a single-threaded event loop (C++20): the coroutine sleeps in co_await until the
+// receive thread publishes a frame, then updates the table and publishes on the loop thread
+Task publish(Optitrack& optitrack, Publisher& publisher)
+{
+    CommandResult frameRate = co_await optitrack.awaitCommand("FrameRate");
+    if (frameRate.ok())
+        std::cout << "Publishing at " << frameRate.as<float>() << " Hz" << std::endl;
+
+    int handle = optitrack.handle("Obstacle_stick");
+    while (true) {
+        co_await optitrack.nextFrame();
+        optitrack.updateData();
+
+        OPTITRACK_TRACE_SCOPE("publish");
+        publisher.publish(optitrack.rigidBody(handle));
+    }
+}
+
+int main(int argc, char const* argv[])
+{
+    Publisher publisher;
+    publisher.configure("0.0.0.0", "5511");
+
+    EventLoop loop;
+    Optitrack optitrack;
+    optitrack.setExecutor(loop.executor());
+    if (!optitrack.connect(argc > 1 ? argv[1] : ""))
+        return 1;
+    optitrack.updateDataDescriptions();
+
+    publish(optitrack, publisher);
+    loop.run();
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include <optitrack_lib/Optitrack.hpp>
+
+using namespace optitrack_lib;
+
+// One connection, three consumers that do not steal frames from each other:
+//   - a control loop on the pose table (waitForFrame + updateData)
+//   - a recorder that writes every rigid body of every frame to a CSV file (lossless reader)
+//   - a monitor that only looks at the newest frame now and then (recent reader)
+//   readers <server> [csv file] [seconds]
+int main(int argc, char const* argv[])
+{
+    const char* path = argc > 2 ? argv[2] : "rigid_bodies.csv";
+    int seconds = argc > 3 ? std::atoi(argv[3]) : 10;
+
+    Optitrack opt;
+    if (!opt.connect(argc > 1 ? argv[1] : ""))
+        return 1;
+    opt.updateDataDescriptions();
+
+    std::atomic<bool> running{true};
+
+    std::thread recorder([&]() {
+        FILE* file = std::fopen(path, "w");
+        if (!file)
+            return;
+
+        std::fprintf(file, "frame,id,x,y,z,qx,qy,qz,qw\n");
+        auto reader = opt.reader(ReadMode::Lossless);
+        while (running)
+            if (reader.wait(std::chrono::milliseconds(100)))
+                reader.poll([&](const MocapFrame& frame) {
+                    for (const sRigidBodyData& body : frame.rigidBodies)
+                        std::fprintf(file, "%d,%d,%f,%f,%f,%f,%f,%f,%f\n", frame.iFrame, body.ID, body.x, body.y, body.z, body.qx, body.qy, body.qz, body.qw);
+                });
+
+        std::printf("recorder: %llu frames to %s\n", static_cast<unsigned long long>(reader.items()), path);
+        std::fclose(file);
+    });
+
+    std::thread monitor([&]() {
+        auto reader = opt.reader(ReadMode::Recent);
+        while (running) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            reader.poll([](const MocapFrame& frame) {
+                std::printf("monitor: frame %d, %zu rigid bodies, %.2f ms latency\n", frame.iFrame, frame.rigidBodies.size(), frame.clientLatencyMillisec);
+            });
+        }
+    });
+
+    // Control loop
+    uint64_t updates = 0;
+    auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    while (std::chrono::steady_clock::now() < end)
+        if (opt.waitForFrame(std::chrono::milliseconds(100))) {
+            opt.updateData();
+            updates++;
+        }
+
+    running = false;
+    recorder.join();
+    monitor.join();
+    std::printf("control loop: %llu updates\n", static_cast<unsigned long long>(updates));
+
+    return 0;
+}
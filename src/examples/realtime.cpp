@@ -0,0 +1,63 @@
+#include <cstdlib>
+#include <iostream>
+#include <optitrack_lib/Optitrack.hpp>
+
+using namespace optitrack_lib;
+
+// Frame jitter percentiles over a few seconds of frames, from the client's jitter histogram
+static void measure(Optitrack& opt, const char* label, int seconds)
+{
+    const Histogram* jitter = opt.metrics().findHistogram("optitrack_frame_jitter_seconds");
+    std::vector<uint64_t> before = jitter->counts();
+
+    auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    while (std::chrono::steady_clock::now() < end)
+        if (opt.waitForFrame(std::chrono::milliseconds(100)))
+            opt.updateData();
+
+    std::vector<uint64_t> window = jitter->counts();
+    uint64_t frames = 0;
+    for (size_t b = 0; b < window.size(); b++) {
+        window[b] -= before[b];
+        frames += window[b];
+    }
+
+    std::printf("%-8s %8llu frames  jitter p50 %7.3f ms  p99 %7.3f ms  p99.9 %7.3f ms\n", label, static_cast<unsigned long long>(frames),
+        metrics::quantile(jitter->bounds(), window, 0.5) * 1e3, metrics::quantile(jitter->bounds(), window, 0.99) * 1e3,
+        metrics::quantile(jitter->bounds(), window, 0.999) * 1e3);
+}
+
+// Compare the frame jitter before and after pinning the receive and consumer threads:
+//   realtime <server> <natnet cpu> <consumer cpu> [SCHED_FIFO priority] [seconds]
+// SCHED_FIFO and memory locking need CAP_SYS_NICE and CAP_IPC_LOCK (or root).
+int main(int argc, char const* argv[])
+{
+    int natnetCpu = argc > 2 ? std::atoi(argv[2]) : 1;
+    int consumerCpu = argc > 3 ? std::atoi(argv[3]) : 2;
+    int priority = argc > 4 ? std::atoi(argv[4]) : 0;
+    int seconds = argc > 5 ? std::atoi(argv[5]) : 10;
+
+    Optitrack opt;
+    opt.enableWatchdog();
+    if (!opt.connect(argc > 1 ? argv[1] : ""))
+        return 1;
+    opt.updateDataDescriptions();
+
+    measure(opt, "default", seconds);
+
+    RealTimeConfig config;
+    config.natnet = {{natnetCpu}, priority, "natnet"};
+    config.commands = {{consumerCpu}, 0, "commands"};
+    config.watchdog = {{consumerCpu}, 0, "watchdog"};
+    config.lockMemory = priority > 0;
+    opt.configureRealTime(config);
+    realtime::configureCurrentThread({{consumerCpu}, priority ? priority - 1 : 0, "consumer"});
+
+    // The receive thread applies its settings on the next frame
+    opt.waitForFrame(std::chrono::milliseconds(1000));
+    std::printf("NatNet receive thread TID %d on CPU %d, consumer on CPU %d\n", static_cast<int>(opt.natnetThreadId()), natnetCpu, consumerCpu);
+
+    measure(opt, "pinned", seconds);
+
+    return 0;
+}
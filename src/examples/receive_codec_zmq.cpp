@@ -0,0 +1,26 @@
+#include <Eigen/Core>
+#include <iostream>
+
+#include <optitrack_lib/PoseCodec.hpp>
+#include <zmq_stream/Subscriber.hpp>
+
+using namespace zmq_stream;
+using namespace optitrack_lib;
+
+int main(int argc, char const* argv[])
+{
+    Subscriber receiver;
+    receiver.configure("localhost", "5511");
+
+    // Packets are variable length; receive into a worst case buffer, the header carries the real size
+    size_t bodies = argc > 1 ? std::atoi(argv[1]) : 100;
+    PoseDecoder decoder;
+
+    while (true) {
+        Eigen::Matrix<uint8_t, Eigen::Dynamic, 1> packet = receiver.receive<Eigen::Matrix<uint8_t, Eigen::Dynamic, 1>>(PoseEncoder::maxPacketSize(bodies));
+
+        // Deltas are skipped until the first keyframe arrives
+        if (decoder.decode(packet.data(), packet.size()))
+            std::cout << decoder.poses() << std::endl;
+    }
+}
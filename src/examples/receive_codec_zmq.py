@@ -0,0 +1,47 @@
+#!/usr/bin/env python
+# encoding: utf-8
+#
+#    This file is part of zmq-stream.
+#
+#    Copyright (c) 2023 Bernardo Fichera <bernardo.fichera@gmail.com>
+#
+#    Permission is hereby granted, free of charge, to any person obtaining a copy
+#    of this software and associated documentation files (the "Software"), to deal
+#    in the Software without restriction, including without limitation the rights
+#    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+#    copies of the Software, and to permit persons to whom the Software is
+#    furnished to do so, subject to the following conditions:
+#
+#    The above copyright notice and this permission notice shall be included in all
+#    copies or substantial portions of the Software.
+#
+#    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+#    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+#    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+#    SOFTWARE.
+
+import sys
+
+import numpy as np
+
+from pose_codec import PoseDecoder
+from zmq_stream.subscriber import Subscriber
+
+# Packets are variable length; receive into a worst case buffer, the header carries the real size
+bodies = int(sys.argv[1]) if len(sys.argv) > 1 else 100
+max_packet_size = 22 + (bodies * (2 + 6 * 64) + 7) // 8
+
+sub = Subscriber()
+sub.configure("localhost", "5511")
+
+decoder = PoseDecoder()
+
+while True:
+    poses = decoder.decode(sub.receive(np.uint8, max_packet_size))
+
+    # Deltas are skipped until the first keyframe arrives
+    if poses is not None:
+        print(poses)
@@ -0,0 +1,48 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include <optitrack_lib/Optitrack.hpp>
+
+using namespace optitrack_lib;
+
+// Poses at a fixed 1 kHz cadence for a high-rate controller, whatever the mocap rate and the network
+// jitter: the resampler timer thread interpolates (or briefly extrapolates) the accepted history.
+//   resample <server> [body] [rate Hz] [delay ms]
+int main(int argc, char const* argv[])
+{
+    Optitrack opt;
+    if (!opt.connect(argc > 1 ? argv[1] : ""))
+        return 1;
+    opt.updateDataDescriptions();
+
+    int handle = opt.handle(argc > 2 ? argv[2] : "Obstacle_stick");
+
+    ResamplerOptions options;
+    options.rate = argc > 3 ? std::atof(argv[3]) : 1000;
+    options.delay = argc > 4 ? std::atof(argv[4]) / 1000 : 0;
+
+    // The callback is the controller: it runs on the timer thread, once per tick
+    std::atomic<uint64_t> ticks{0}, extrapolated{0}, held{0};
+    opt.startResampler(options, [&](const Resampler& resampler) {
+        if (resampler.kind(handle) == SampleKind::Missing)
+            return;
+
+        Eigen::Matrix<double, 7, 1> pose = resampler.pose(handle);
+        (void)pose; // command the robot here
+
+        ticks++;
+        extrapolated += resampler.kind(handle) == SampleKind::Extrapolated;
+        held += resampler.kind(handle) == SampleKind::Held;
+    });
+
+    for (int i = 0; i < 10; i++) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        std::printf("%llu ticks, %llu extrapolated, %llu held\n", static_cast<unsigned long long>(ticks.exchange(0)),
+            static_cast<unsigned long long>(extrapolated.exchange(0)), static_cast<unsigned long long>(held.exchange(0)));
+    }
+    opt.stopResampler();
+
+    return 0;
+}
@@ -0,0 +1,268 @@
+#ifndef OPTITRACKLIB_BROADCASTRING_HPP
+#define OPTITRACKLIB_BROADCASTRING_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include "optitrack_lib/Log.hpp"
+
+namespace optitrack_lib {
+    enum class ReadMode {
+        Lossless, // every item; a reader a whole ring behind holds the writer back
+        Recent, // the newest `window` items per poll, older ones are skipped; never holds the writer back
+    };
+
+    // Single-writer, multi-reader ring of sequence-numbered items, each reader with its own cursor
+    // (disruptor style). The writer fills slots in place and publishes them; readers get const
+    // references into the ring, so nothing is copied or locked per item. A reader's cursor is the
+    // oldest sequence it may still read: lossless readers always hold theirs, recent readers only
+    // while polling. The writer never overwrites a held slot; it waits for the holder up to a timeout
+    // and then drops the item, and until the holder moves it drops without waiting again.
+    template <typename T, size_t Capacity>
+    class BroadcastRing {
+        static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "BroadcastRing capacity must be a power of two");
+
+    public:
+        static constexpr size_t kMaxReaders = 16;
+
+        static constexpr size_t capacity() { return Capacity; }
+
+        // Registration of one reader; used by one thread at a time and must not outlive the ring
+        class Reader {
+        public:
+            Reader() = default;
+
+            Reader(Reader&& other) noexcept { *this = std::move(other); }
+
+            Reader& operator=(Reader&& other) noexcept
+            {
+                release();
+                std::swap(_ring, other._ring);
+                _id = other._id;
+                _mode = other._mode;
+                _window = other._window;
+                _next.store(other._next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                _items = other._items;
+                _skipped = other._skipped;
+                return *this;
+            }
+
+            ~Reader() { release(); }
+
+            bool valid() const { return _ring != nullptr; }
+
+            // Calls f(item) for the new items, oldest first, or f(item, newest) to know the last one;
+            // references are valid during the call only. Returns the number of items.
+            template <typename F>
+            size_t poll(F&& f) { return _ring->poll(*this, f); }
+
+            // Block until an item newer than the last poll is published; false on timeout
+            bool wait(std::chrono::milliseconds timeout) const { return _ring->wait(*this, timeout); }
+
+            // Published items not polled yet, any thread
+            int64_t lag() const { return _ring->published() + 1 - _next.load(std::memory_order_relaxed); }
+
+            uint64_t items() const { return _items; }
+
+            // Items a recent reader did not see because newer ones were published
+            uint64_t skipped() const { return _skipped; }
+
+        protected:
+            friend class BroadcastRing;
+
+            void release()
+            {
+                if (_ring)
+                    _ring->remove(_id);
+                _ring = nullptr;
+            }
+
+            BroadcastRing* _ring = nullptr;
+            int _id = -1;
+            ReadMode _mode = ReadMode::Lossless;
+            int64_t _window = 1;
+            std::atomic<int64_t> _next{0};
+            uint64_t _items = 0, _skipped = 0;
+        };
+
+        // An invalid reader when all kMaxReaders are taken. The reader starts with the next published
+        // item; a recent window is limited to Capacity - 1 so the writer always has a free slot.
+        Reader reader(ReadMode mode, size_t window = 1)
+        {
+            Reader reader;
+            for (int i = 0; i < static_cast<int>(kMaxReaders); i++) {
+                bool used = false;
+                if (!_cursors[i].used.compare_exchange_strong(used, true))
+                    continue;
+
+                // The writer scans the new cursor before it is held
+                int count = _readerCount.load();
+                while (count <= i && !_readerCount.compare_exchange_weak(count, i + 1)) {
+                }
+
+                reader._ring = this;
+                reader._id = i;
+                reader._mode = mode;
+                reader._window = static_cast<int64_t>(std::min(std::max(window, size_t(1)), Capacity - 1));
+                reader._next = published() + 1;
+                if (mode == ReadMode::Lossless)
+                    reader._next = hold(i, reader._next);
+                return reader;
+            }
+
+            OPTITRACK_LOG_WARN("No free reader among %zu", kMaxReaders);
+            return reader;
+        }
+
+        // Writer: slot of the next item, nullptr when it is dropped (see above); waited is the time
+        // spent waiting for readers
+        T* claim(std::chrono::nanoseconds timeout, std::chrono::nanoseconds& waited)
+        {
+            waited = std::chrono::nanoseconds(0);
+            int64_t sequence = _published.load(std::memory_order_relaxed) + 1;
+            _claimed.store(sequence);
+
+            int64_t overwritten = sequence - static_cast<int64_t>(Capacity);
+            if (overwritten >= 0 && held(overwritten)) {
+                if (!_stalled) {
+                    auto start = std::chrono::steady_clock::now(), now = start;
+                    while (held(overwritten) && (now = std::chrono::steady_clock::now()) < start + timeout)
+                        std::this_thread::yield();
+                    waited = now - start;
+                }
+
+                if (held(overwritten)) {
+                    _claimed.store(sequence - 1);
+                    _stalled = true;
+                    _dropped.fetch_add(1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+            }
+
+            _stalled = false;
+            return &_slots[sequence & kMask];
+        }
+
+        // Writer: make the claimed item visible
+        void publish()
+        {
+            _published.store(_claimed.load(std::memory_order_relaxed), std::memory_order_release);
+
+            // Waking waiters costs a lock, only pay it when someone waits. The fence keeps the _waiters
+            // load after the store above (StoreLoad), paired with the fence in wait(): either this sees
+            // the waiter or the waiter sees the item.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_waiters.load(std::memory_order_relaxed)) {
+                { std::lock_guard<std::mutex> lock(_mutex); }
+                _condition.notify_all();
+            }
+        }
+
+        // Sequence of the newest published item, -1 before the first
+        int64_t published() const { return _published.load(std::memory_order_acquire); }
+
+        // Items dropped because a reader held their slot
+        uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    protected:
+        static constexpr int64_t kIdle = std::numeric_limits<int64_t>::max();
+        static constexpr int64_t kMask = static_cast<int64_t>(Capacity) - 1;
+
+        struct alignas(64) Cursor {
+            std::atomic<int64_t> sequence{kIdle};
+            std::atomic<bool> used{false};
+        };
+
+        // Whether a reader still needs the item the writer is about to overwrite
+        bool held(int64_t sequence) const
+        {
+            int count = _readerCount.load();
+            for (int i = 0; i < count; i++)
+                if (_cursors[i].sequence.load() <= sequence)
+                    return true;
+            return false;
+        }
+
+        // Hold items from sequence on. The cursor store and the writer's claim are both sequentially
+        // consistent, so either the writer sees the cursor or the reader sees the claim and moves past
+        // the slot being overwritten.
+        int64_t hold(int id, int64_t sequence)
+        {
+            for (;;) {
+                _cursors[id].sequence.store(sequence);
+                int64_t oldest = _claimed.load() - static_cast<int64_t>(Capacity) + 1;
+                if (sequence >= oldest)
+                    return sequence;
+                sequence = oldest;
+            }
+        }
+
+        template <typename F>
+        size_t poll(Reader& reader, F& f)
+        {
+            int64_t last = published();
+            int64_t next = reader._next.load(std::memory_order_relaxed);
+            if (last < next)
+                return 0;
+
+            int64_t first = next;
+            if (reader._mode == ReadMode::Recent) {
+                first = hold(reader._id, std::max(next, last - reader._window + 1));
+                reader._skipped += first - next;
+            }
+
+            for (int64_t sequence = first; sequence <= last; sequence++) {
+                if constexpr (std::is_invocable<F&, const T&, bool>::value)
+                    f(static_cast<const T&>(_slots[sequence & kMask]), sequence == last);
+                else
+                    f(static_cast<const T&>(_slots[sequence & kMask]));
+            }
+
+            _cursors[reader._id].sequence.store(reader._mode == ReadMode::Lossless ? last + 1 : kIdle, std::memory_order_release);
+            reader._next.store(last + 1, std::memory_order_relaxed);
+            reader._items += last + 1 - first;
+            return static_cast<size_t>(last + 1 - first);
+        }
+
+        bool wait(const Reader& reader, std::chrono::milliseconds timeout)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _waiters++;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool arrived = _condition.wait_for(lock, timeout, [&]() { return published() >= reader._next.load(std::memory_order_relaxed); });
+            _waiters--;
+            return arrived;
+        }
+
+        void remove(int id)
+        {
+            _cursors[id].sequence.store(kIdle, std::memory_order_release);
+            _cursors[id].used.store(false, std::memory_order_release);
+        }
+
+        std::array<T, Capacity> _slots;
+
+        // Writer side
+        alignas(64) std::atomic<int64_t> _claimed{-1};
+        std::atomic<int64_t> _published{-1};
+        std::atomic<uint64_t> _dropped{0};
+        bool _stalled = false;
+
+        std::array<Cursor, kMaxReaders> _cursors;
+        std::atomic<int> _readerCount{0};
+
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::atomic<int> _waiters{0};
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_BROADCASTRING_HPP
@@ -0,0 +1,98 @@
+#ifndef OPTITRACKLIB_CLOCKMODEL_HPP
+#define OPTITRACKLIB_CLOCKMODEL_HPP
+
+#include <algorithm>
+#include <cmath>
+
+namespace optitrack_lib {
+    struct ClockEstimate {
+        double time = 0; // seconds in the target clock
+        double errorBound = 0; // seconds, about three standard deviations
+    };
+
+    // Online robust fit of y = offset + slope * x between two clocks (e.g. host exposure seconds and local
+    // steady_clock seconds). Exponentially weighted least squares on centered moments (numerically stable
+    // over long runs) with Huber weights against outliers; every update is O(1).
+    class ClockModel {
+    public:
+        // forgetting: per-sample decay of old observations; huber: residual (in scale units) beyond which weights decay
+        ClockModel(double forgetting = 0.999, double huber = 2.0) : _forgetting(forgetting), _huber(huber) {}
+
+        void reset() { *this = ClockModel(_forgetting, _huber); }
+
+        size_t samples() const { return _samples; }
+
+        // Relative rate difference between the two clocks (slope - 1)
+        double drift() const { return slope() - 1; }
+
+        double slope() const { return _cxx > 0 ? _cxy / _cxx : 1; }
+
+        double offset() const { return _my - slope() * _mx; }
+
+        // Robust standard deviation of the residuals
+        double scale() const { return _scale; }
+
+        void update(double x, double y)
+        {
+            // Keep numbers small: both clocks are expressed relative to the first observation
+            if (_samples == 0) {
+                _x0 = x;
+                _y0 = y;
+            }
+            x -= _x0;
+            y -= _y0;
+
+            double weight = 1;
+            if (_samples >= 2) {
+                double residual = std::abs(y - predictCentered(x));
+                bool warm = _samples > kWarmup;
+                double limit = std::max(_scale, kMinScale) * _huber;
+
+                if (warm && residual > limit)
+                    weight = limit / residual;
+
+                // Scale tracks the clipped absolute residual (1.25 converts mean absolute deviation to sigma)
+                double gain = warm ? kScaleGain : 1.0 / (_samples - 1);
+                _scale += gain * (1.25 * (warm ? std::min(residual, 3 * limit) : residual) - _scale);
+            }
+
+            _sw = _forgetting * _sw + weight;
+            double dx = x - _mx, dy = y - _my;
+            _mx += weight * dx / _sw;
+            _my += weight * dy / _sw;
+            _cxx = _forgetting * _cxx + weight * dx * (x - _mx);
+            _cxy = _forgetting * _cxy + weight * dx * (y - _my);
+            _samples++;
+        }
+
+        ClockEstimate predict(double x) const
+        {
+            ClockEstimate estimate;
+            x -= _x0;
+            estimate.time = predictCentered(x) + _y0;
+
+            // Prediction interval of a weighted linear fit
+            double leverage = _sw > 0 ? 1 / _sw : 1;
+            if (_cxx > 0)
+                leverage += (x - _mx) * (x - _mx) / _cxx;
+            estimate.errorBound = 3 * _scale * std::sqrt(1 + leverage);
+
+            return estimate;
+        }
+
+    protected:
+        static constexpr size_t kWarmup = 16;
+        static constexpr double kScaleGain = 0.01;
+        static constexpr double kMinScale = 1e-7;
+
+        double _forgetting, _huber;
+        size_t _samples = 0;
+        double _x0 = 0, _y0 = 0;
+        double _sw = 0, _mx = 0, _my = 0, _cxx = 0, _cxy = 0;
+        double _scale = 0;
+
+        double predictCentered(double x) const { return _my + slope() * (x - _mx); }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_CLOCKMODEL_HPP
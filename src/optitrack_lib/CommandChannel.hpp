@@ -0,0 +1,175 @@
+#ifndef OPTITRACKLIB_COMMANDCHANNEL_HPP
+#define OPTITRACKLIB_COMMANDCHANNEL_HPP
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <NatNet/NatNetClient.h>
+#include <NatNet/NatNetTypes.h>
+
+#include "optitrack_lib/Tracing.hpp"
+
+namespace optitrack_lib {
+    struct CommandResult {
+        ErrorCode code = ErrorCode_OK;
+        std::vector<char> response;
+
+        bool ok() const { return code == ErrorCode_OK; }
+
+        // Interpret the raw server response as a POD value (e.g. float for "FrameRate")
+        template <typename T>
+        T as() const
+        {
+            T value{};
+            if (response.size() >= sizeof(T))
+                std::memcpy(&value, response.data(), sizeof(T));
+            return value;
+        }
+
+        std::string str() const { return std::string(response.data(), strnlen(response.data(), response.size())); }
+    };
+
+    using CommandCallback = std::function<void(const CommandResult&)>;
+
+    // Dedicated thread serving NatNet request/response commands.
+    // Callers never block: every command returns a future or completes a callback,
+    // and any number of commands can be queued while one is on the wire.
+    // Only one is ever on the wire: SendMessageAndWait blocks until its response, responses carry
+    // no request id to match them with, and the response buffer is reused by the next command.
+    class CommandChannel {
+    public:
+        CommandChannel(NatNetClient* client, int tries = 10, int timeout = 20) : _client(client), _tries(tries), _timeout(timeout)
+        {
+            _thread = std::thread(&CommandChannel::run, this);
+        }
+
+        ~CommandChannel()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _condition.notify_one();
+            _thread.join();
+        }
+
+        // tries/timeout (ms) < 0 use the channel defaults
+        std::future<CommandResult> send(const std::string& request, int tries = -1, int timeout = -1)
+        {
+            Command command{request, tries, timeout, std::promise<CommandResult>(), nullptr};
+            std::future<CommandResult> result = command.promise.get_future();
+            push(std::move(command));
+            return result;
+        }
+
+        // The callback runs on the command thread
+        void send(const std::string& request, CommandCallback callback, int tries = -1, int timeout = -1)
+        {
+            push(Command{request, tries, timeout, std::promise<CommandResult>(), std::move(callback)});
+        }
+
+        void setDefaults(int tries, int timeout)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tries = tries;
+            _timeout = timeout;
+        }
+
+        size_t inFlight()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _queue.size() + (_busy ? 1 : 0);
+        }
+
+        // Keep the wire while the lock is held, e.g. to reconnect the client: waits for the command
+        // being sent, later ones stay queued until the lock is released
+        std::unique_lock<std::mutex> pause() { return std::unique_lock<std::mutex>(_wireMutex); }
+
+        std::thread& thread() { return _thread; }
+
+    protected:
+        struct Command {
+            std::string request;
+            int tries, timeout;
+            std::promise<CommandResult> promise;
+            CommandCallback callback;
+        };
+
+        NatNetClient* _client;
+        int _tries, _timeout;
+
+        std::thread _thread;
+        std::mutex _mutex, _wireMutex;
+        std::condition_variable _condition;
+        std::deque<Command> _queue;
+        bool _stop = false, _busy = false;
+
+        void push(Command&& command)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _queue.push_back(std::move(command));
+            }
+            _condition.notify_one();
+        }
+
+        void run()
+        {
+            OPTITRACK_TRACE_THREAD("commands");
+
+            while (true) {
+                Command command;
+                bool stopping;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _busy = false;
+                    _condition.wait(lock, [this] { return _stop || !_queue.empty(); });
+
+                    if (_queue.empty())
+                        return;
+
+                    // Drain pending commands before stopping so that no future is left unresolved
+                    command = std::move(_queue.front());
+                    _queue.pop_front();
+                    _busy = true;
+
+                    if (command.tries < 0)
+                        command.tries = _tries;
+                    if (command.timeout < 0)
+                        command.timeout = _timeout;
+
+                    stopping = _stop;
+                }
+
+                CommandResult result;
+                if (stopping)
+                    result.code = ErrorCode_InvalidOperation;
+                else {
+                    void* response = nullptr;
+                    int nBytes = 0;
+                    OPTITRACK_TRACE_SCOPE("SendMessageAndWait");
+                    std::lock_guard<std::mutex> wire(_wireMutex);
+                    result.code = _client->SendMessageAndWait(command.request.c_str(), command.tries, command.timeout, &response, &nBytes);
+
+                    // The response buffer belongs to NatNet and is reused by the next command
+                    if (result.code == ErrorCode_OK && response && nBytes > 0)
+                        result.response.assign(static_cast<char*>(response), static_cast<char*>(response) + nBytes);
+                }
+
+                if (command.callback)
+                    command.callback(result);
+                else
+                    command.promise.set_value(std::move(result));
+            }
+        }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_COMMANDCHANNEL_HPP
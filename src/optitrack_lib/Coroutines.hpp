@@ -0,0 +1,161 @@
+#ifndef OPTITRACKLIB_COROUTINES_HPP
+#define OPTITRACKLIB_COROUTINES_HPP
+
+// C++20 coroutine support. Empty before C++20, the rest of the library keeps building as C++17;
+// OPTITRACK_COROUTINES tells whether the awaitables of the client are available.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define OPTITRACK_COROUTINES 1
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace optitrack_lib {
+    // Where awaiting coroutines resume. It is called with the coroutine on the thread that completes
+    // the wait (the NatNet thread for frames, updateData() for poses, the command thread for commands),
+    // so the default resumes right there without a thread hop. With an event loop, post instead:
+    //
+    //     client.setExecutor([&io](std::coroutine_handle<> h) { asio::post(io, [h]() { h.resume(); }); });
+    using Executor = std::function<void(std::coroutine_handle<>)>;
+
+    inline void resumeInline(std::coroutine_handle<> coroutine) { coroutine.resume(); }
+
+    // Minimal single-threaded executor: coroutines posted from any thread resume in run()
+    class EventLoop {
+    public:
+        Executor executor()
+        {
+            return [this](std::coroutine_handle<> coroutine) { post(coroutine); };
+        }
+
+        void post(std::coroutine_handle<> coroutine)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _ready.push_back(coroutine);
+            }
+            _condition.notify_one();
+        }
+
+        // Resume posted coroutines until stop()
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (!_stopped) {
+                _condition.wait(lock, [this]() { return _stopped || !_ready.empty(); });
+                resumeReady(lock);
+            }
+            _stopped = false;
+        }
+
+        // Resume the coroutines posted so far without blocking; returns their number
+        size_t poll()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            return resumeReady(lock);
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stopped = true;
+            }
+            _condition.notify_one();
+        }
+
+    protected:
+        // Batches swap between the two vectors, so they keep their capacity
+        size_t resumeReady(std::unique_lock<std::mutex>& lock)
+        {
+            _running.swap(_ready);
+            lock.unlock();
+            for (std::coroutine_handle<> coroutine : _running)
+                coroutine.resume();
+            size_t resumed = _running.size();
+            _running.clear();
+            lock.lock();
+            return resumed;
+        }
+
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::vector<std::coroutine_handle<>> _ready, _running;
+        bool _stopped = false;
+    };
+
+    // Detached coroutine: starts right away and frees itself when it returns, e.g.
+    //
+    //     Task publish(Optitrack& client) { for (;;) { co_await client.nextFrame(); ... } }
+    struct Task {
+        struct promise_type {
+            Task get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    namespace detail {
+        // Coroutines suspended until a condition set by one notifying thread becomes true. The
+        // notifier only locks when someone waits: registration and notification both fence, so
+        // either the notifier sees the waiter or the waiter sees the condition and does not suspend.
+        class AwaitList {
+        public:
+            // Register the coroutine unless ready() already holds; false when it must not suspend
+            template <typename Ready>
+            bool suspend(std::coroutine_handle<> coroutine, const Executor* executor, Ready&& ready)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _waiting.push_back({coroutine, executor});
+                _count.store(_waiting.size(), std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!ready())
+                    return true;
+
+                _waiting.pop_back();
+                _count.store(_waiting.size(), std::memory_order_relaxed);
+                return false;
+            }
+
+            // Call after making the condition true; resumes the waiters through their executors
+            void notify()
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!_count.load(std::memory_order_relaxed))
+                    return;
+
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _resuming.swap(_waiting);
+                    _count.store(0, std::memory_order_relaxed);
+                }
+
+                // Coroutines resumed inline may wait again, they land in _waiting
+                for (const Waiter& waiter : _resuming)
+                    (*waiter.executor)(waiter.coroutine);
+                _resuming.clear();
+            }
+
+        protected:
+            struct Waiter {
+                std::coroutine_handle<> coroutine;
+                const Executor* executor;
+            };
+
+            std::mutex _mutex;
+            std::vector<Waiter> _waiting, _resuming;
+            std::atomic<size_t> _count{0};
+        };
+    } // namespace detail
+} // namespace optitrack_lib
+
+#endif
+
+#endif // OPTITRACKLIB_COROUTINES_HPP
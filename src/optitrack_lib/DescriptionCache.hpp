@@ -0,0 +1,345 @@
+#ifndef OPTITRACKLIB_DESCRIPTIONCACHE_HPP
+#define OPTITRACKLIB_DESCRIPTIONCACHE_HPP
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <NatNet/NatNetTypes.h>
+
+#include "optitrack_lib/Discovery.hpp"
+#include "optitrack_lib/Log.hpp"
+
+namespace optitrack_lib {
+    namespace detail {
+        inline uint64_t fnv1a(const char* data, size_t length, uint64_t hash = 14695981039346656037ull)
+        {
+            for (size_t i = 0; i < length; i++)
+                hash = (hash ^ static_cast<uint8_t>(data[i])) * 1099511628211ull;
+            return hash;
+        }
+
+        // splitmix64 finalizer, decorrelates the slot hash from the bucket hash
+        inline uint64_t mix(uint64_t x)
+        {
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+            return x ^ (x >> 31);
+        }
+    } // namespace detail
+
+    // Identity of a server for the description cache: host name, address and application version
+    inline uint64_t serverKey(const sServerDescription& server)
+    {
+        uint64_t key = detail::fnv1a(server.szHostComputerName, strnlen(server.szHostComputerName, MAX_NAMELENGTH));
+        key = detail::fnv1a(reinterpret_cast<const char*>(server.HostComputerAddress), 4, key);
+        key = detail::fnv1a(server.szHostApp, strnlen(server.szHostApp, MAX_NAMELENGTH), key);
+        return detail::fnv1a(reinterpret_cast<const char*>(server.HostAppVersion), 4, key);
+    }
+
+    // Compact, immutable copy of a description list: one record per asset, names interned in a single
+    // string block, rigid body marker positions in one flat array, and a perfect hash from name to
+    // asset. The whole model is one contiguous block, saved as is and memory mapped back by open(), so
+    // a restarted client resolves its handles before the server answers the description request.
+    class DescriptionCache {
+    public:
+        struct Asset {
+            int32_t type; // DataDescriptors
+            int32_t id; // streaming ID, -1 for marker sets
+            int32_t order; // index of the asset's data in the frame
+            int32_t parentID; // rigid bodies, -1 without hierarchy
+            uint32_t name, nameLength; // offset in the string block
+            uint32_t markerBegin, markerCount; // rigid body marker positions
+        };
+
+        DescriptionCache(const DescriptionCache&) = delete;
+        DescriptionCache& operator=(const DescriptionCache&) = delete;
+
+        ~DescriptionCache()
+        {
+            if (_mapping)
+                munmap(_mapping, _bytes);
+        }
+
+        // Cameras are left out, they are not part of the frame data
+        static std::shared_ptr<const DescriptionCache> build(const sDataDescriptions& descriptions, uint64_t serverKey)
+        {
+            std::vector<Asset> assets;
+            std::vector<float> markers; // x y z per marker
+            std::string strings;
+            int32_t order = 0;
+
+            for (int i = 0; i < descriptions.nDataDescriptions; i++) {
+                const sDataDescription& description = descriptions.arrDataDescriptions[i];
+                Asset asset = {description.type, -1, -1, -1, 0, 0, static_cast<uint32_t>(markers.size() / 3), 0};
+                const char* name = "";
+
+                switch (description.type) {
+                case Descriptor_MarkerSet:
+                    name = description.Data.MarkerSetDescription->szName;
+                    break;
+                case Descriptor_RigidBody: {
+                    const sRigidBodyDescription& body = *description.Data.RigidBodyDescription;
+                    asset.id = body.ID;
+                    asset.parentID = body.parentID;
+                    asset.markerCount = body.MarkerPositions ? std::max(body.nMarkers, 0) : 0;
+                    if (asset.markerCount)
+                        markers.insert(markers.end(), &body.MarkerPositions[0][0], &body.MarkerPositions[0][0] + 3 * asset.markerCount);
+                    name = body.szName;
+                    break;
+                }
+                case Descriptor_Skeleton:
+                    asset.id = description.Data.SkeletonDescription->skeletonID;
+                    name = description.Data.SkeletonDescription->szName;
+                    break;
+                case Descriptor_ForcePlate:
+                    asset.id = description.Data.ForcePlateDescription->ID;
+                    name = description.Data.ForcePlateDescription->strSerialNo;
+                    break;
+                case Descriptor_Device:
+                    asset.id = description.Data.DeviceDescription->ID;
+                    name = description.Data.DeviceDescription->strName;
+                    break;
+                case Descriptor_Asset:
+                    asset.id = description.Data.AssetDescription->AssetID;
+                    name = description.Data.AssetDescription->szName;
+                    break;
+                case Descriptor_Camera:
+                    continue;
+                default:
+                    OPTITRACK_LOG_WARN("Unknown data type in description list : %d", description.type);
+                    continue;
+                }
+
+                asset.order = order++;
+                asset.name = static_cast<uint32_t>(strings.size());
+                asset.nameLength = static_cast<uint32_t>(strlen(name));
+                strings.append(name, asset.nameLength + 1);
+                assets.push_back(asset);
+            }
+
+            std::shared_ptr<DescriptionCache> cache(new DescriptionCache());
+            cache->_storage.resize(layout(assets.size(), markers.size() / 3, strings.size(), cache->_layout));
+            cache->_bytes = cache->_storage.size();
+            cache->_data = cache->_storage.data();
+
+            cache->_layout.serverKey = serverKey;
+            const Header& header = *reinterpret_cast<Header*>(cache->_data) = cache->_layout;
+            std::copy(assets.begin(), assets.end(), cache->mutableAssets());
+            std::copy(markers.begin(), markers.end(), reinterpret_cast<float*>(cache->_data + header.markerOffset));
+            std::copy(strings.begin(), strings.end(), cache->_data + header.stringOffset);
+            cache->buildHash();
+            return cache;
+        }
+
+        // Maps a file written by save(); nullptr when missing, corrupt or from another server
+        static std::shared_ptr<const DescriptionCache> open(const std::string& path, uint64_t serverKey)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return nullptr;
+
+            struct stat status;
+            void* mapping = MAP_FAILED;
+            if (fstat(fd, &status) == 0 && status.st_size >= static_cast<off_t>(sizeof(Header)))
+                mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (mapping == MAP_FAILED)
+                return nullptr;
+
+            std::shared_ptr<DescriptionCache> cache(new DescriptionCache());
+            cache->_mapping = mapping;
+            cache->_bytes = status.st_size;
+            cache->_data = static_cast<char*>(mapping);
+
+            if (!cache->validate()) {
+                OPTITRACK_LOG_WARN("Ignoring invalid description cache %s", path.c_str());
+                return nullptr;
+            }
+            if (cache->serverKey() != serverKey) {
+                OPTITRACK_LOG_INFO("Description cache %s belongs to another server", path.c_str());
+                return nullptr;
+            }
+            return cache;
+        }
+
+        // Atomic replace, like ConnectionSettings::save
+        bool save(const std::string& path) const { return detail::replaceFile(path, _data, _bytes); }
+
+        uint64_t serverKey() const { return header().serverKey; }
+
+        size_t size() const { return _layout.assets; }
+
+        // Size of the model (and of its file) in bytes
+        size_t bytes() const { return _bytes; }
+
+        bool mapped() const { return _mapping != nullptr; }
+
+        const Asset& asset(int i) const { return assets()[i]; }
+
+        const char* name(int i) const { return _data + _layout.stringOffset + assets()[i].name; }
+
+        const MarkerData* markers(int i) const { return reinterpret_cast<const MarkerData*>(_data + _layout.markerOffset) + assets()[i].markerBegin; }
+
+        // Index of the first asset of that name, -1 if there is none; one probe and one comparison
+        int find(const char* name, size_t length) const
+        {
+            if (!_layout.assets)
+                return -1;
+
+            uint64_t hash = detail::fnv1a(name, length);
+            uint32_t seed = seeds()[hash % _layout.assets];
+            int32_t i = slots()[detail::mix(hash + seed) % _layout.slots];
+            if (i < 0 || assets()[i].nameLength != length || memcmp(this->name(i), name, length) != 0)
+                return -1;
+            return i;
+        }
+
+        int find(const std::string& name) const { return find(name.data(), name.size()); }
+
+        // Same server and same descriptions
+        bool operator==(const DescriptionCache& other) const { return _bytes == other._bytes && memcmp(_data, other._data, _bytes) == 0; }
+
+        bool operator!=(const DescriptionCache& other) const { return !(*this == other); }
+
+    protected:
+        static constexpr uint32_t kMagic = 0x4344544f; // "OTDC"
+        static constexpr uint32_t kVersion = 1;
+
+        // File and memory layout: header, assets, bucket seeds, slots, marker positions, strings
+        struct Header {
+            uint32_t magic, version;
+            uint64_t serverKey;
+            uint32_t assets, slots, markers, stringBytes;
+            uint64_t assetOffset, seedOffset, slotOffset, markerOffset, stringOffset, bytes;
+        };
+
+        DescriptionCache() = default;
+
+        static uint64_t align(uint64_t offset) { return (offset + 7) & ~uint64_t(7); }
+
+        static size_t layout(size_t assets, size_t markers, size_t stringBytes, Header& header)
+        {
+            header = Header();
+            header.magic = kMagic;
+            header.version = kVersion;
+            header.assets = static_cast<uint32_t>(assets);
+            header.slots = static_cast<uint32_t>(assets + assets / 4 + 1); // load factor 0.8
+            header.markers = static_cast<uint32_t>(markers);
+            header.stringBytes = static_cast<uint32_t>(stringBytes);
+            header.assetOffset = align(sizeof(Header));
+            header.seedOffset = align(header.assetOffset + assets * sizeof(Asset));
+            header.slotOffset = align(header.seedOffset + assets * sizeof(uint32_t));
+            header.markerOffset = align(header.slotOffset + header.slots * sizeof(int32_t));
+            header.stringOffset = align(header.markerOffset + markers * sizeof(MarkerData));
+            header.bytes = align(header.stringOffset + stringBytes);
+            return header.bytes;
+        }
+
+        const Header& header() const { return *reinterpret_cast<const Header*>(_data); }
+
+        const Asset* assets() const { return reinterpret_cast<const Asset*>(_data + _layout.assetOffset); }
+
+        const uint32_t* seeds() const { return reinterpret_cast<const uint32_t*>(_data + _layout.seedOffset); }
+
+        const int32_t* slots() const { return reinterpret_cast<const int32_t*>(_data + _layout.slotOffset); }
+
+        Asset* mutableAssets() { return reinterpret_cast<Asset*>(_data + _layout.assetOffset); }
+
+        // Hash and displace: buckets by the name hash, largest first, each gets the first seed that
+        // places all of its names in free slots. Duplicate names keep their first asset.
+        void buildHash()
+        {
+            uint32_t n = _layout.assets, m = _layout.slots;
+            uint32_t* seeds = reinterpret_cast<uint32_t*>(_data + _layout.seedOffset);
+            int32_t* slots = reinterpret_cast<int32_t*>(_data + _layout.slotOffset);
+            std::fill(seeds, seeds + n, 0u);
+            std::fill(slots, slots + m, -1);
+
+            std::vector<uint64_t> hashes(n);
+            std::vector<std::vector<uint32_t>> buckets(n);
+            for (uint32_t i = 0; i < n; i++) {
+                hashes[i] = detail::fnv1a(name(i), assets()[i].nameLength);
+                std::vector<uint32_t>& bucket = buckets[hashes[i] % n];
+                bool duplicate = false;
+                for (uint32_t j : bucket)
+                    duplicate |= hashes[j] == hashes[i] && strcmp(name(j), name(i)) == 0;
+                if (duplicate)
+                    OPTITRACK_LOG_WARN("Duplicate asset name %s in description list", name(i));
+                else
+                    bucket.push_back(i);
+            }
+
+            std::vector<uint32_t> order(n);
+            for (uint32_t b = 0; b < n; b++)
+                order[b] = b;
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+            std::vector<uint32_t> placed;
+            for (uint32_t b : order) {
+                if (buckets[b].empty())
+                    break;
+
+                for (uint32_t seed = 0;; seed++) {
+                    placed.clear();
+                    for (uint32_t i : buckets[b]) {
+                        uint32_t slot = static_cast<uint32_t>(detail::mix(hashes[i] + seed) % m);
+                        if (slots[slot] >= 0 || std::find(placed.begin(), placed.end(), slot) != placed.end())
+                            break;
+                        placed.push_back(slot);
+                    }
+                    if (placed.size() == buckets[b].size()) {
+                        seeds[b] = seed;
+                        for (size_t k = 0; k < placed.size(); k++)
+                            slots[placed[k]] = static_cast<int32_t>(buckets[b][k]);
+                        break;
+                    }
+                }
+            }
+        }
+
+        // Bounds of every section and index, so that a truncated or foreign file is never dereferenced:
+        // the file's header must match the layout recomputed from its counts, which then becomes _layout
+        bool validate()
+        {
+            Header expected;
+            const Header& h = header();
+            if (h.magic != kMagic || h.version != kVersion || layout(h.assets, h.markers, h.stringBytes, expected) != _bytes)
+                return false;
+            if (h.slots != expected.slots || h.bytes != expected.bytes || h.assetOffset != expected.assetOffset || h.seedOffset != expected.seedOffset
+                || h.slotOffset != expected.slotOffset || h.markerOffset != expected.markerOffset || h.stringOffset != expected.stringOffset)
+                return false;
+            expected.serverKey = h.serverKey;
+            _layout = expected;
+
+            if (!h.stringBytes || _data[h.stringOffset + h.stringBytes - 1] != '\0')
+                return h.assets == 0;
+
+            for (uint32_t i = 0; i < h.assets; i++) {
+                const Asset& asset = assets()[i];
+                if (uint64_t(asset.name) + asset.nameLength >= h.stringBytes || uint64_t(asset.markerBegin) + asset.markerCount > h.markers)
+                    return false;
+            }
+            for (uint32_t s = 0; s < h.slots; s++)
+                if (slots()[s] >= static_cast<int32_t>(h.assets))
+                    return false;
+            return true;
+        }
+
+        Header _layout; // copy of the header, read on every lookup
+        std::vector<char> _storage;
+        void* _mapping = nullptr;
+        char* _data = nullptr;
+        size_t _bytes = 0;
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_DESCRIPTIONCACHE_HPP
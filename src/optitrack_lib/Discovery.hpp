@@ -0,0 +1,258 @@
+#ifndef OPTITRACKLIB_DISCOVERY_HPP
+#define OPTITRACKLIB_DISCOVERY_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <inttypes.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <NatNet/NatNetCAPI.h>
+#include <NatNet/NatNetTypes.h>
+
+namespace optitrack_lib {
+    namespace detail {
+        // Atomic replace so that concurrent readers never see a partial file. The temporary comes from
+        // mkstemp: mode 0600 whatever the umask, and never opened through a link planted at its name.
+        inline bool replaceFile(const std::string& path, const void* data, size_t size)
+        {
+            std::string temporary = path + ".XXXXXX";
+            int fd = mkstemp(&temporary[0]);
+            if (fd < 0)
+                return false;
+
+            const char* bytes = static_cast<const char*>(data);
+            bool ok = true;
+            for (size_t done = 0; ok && done < size;) {
+                ssize_t written = ::write(fd, bytes + done, size - done);
+                if (written < 0 && errno == EINTR)
+                    continue;
+                ok = written > 0;
+                done += ok ? static_cast<size_t>(written) : 0;
+            }
+            ok = ok && fsync(fd) == 0;
+            ok &= ::close(fd) == 0;
+
+            if (ok && std::rename(temporary.c_str(), path.c_str()) == 0)
+                return true;
+            ::unlink(temporary.c_str());
+            return false;
+        }
+    } // namespace detail
+
+    // Owning version of sNatNetClientConnectParams (the NatNet struct only keeps raw pointers)
+    struct ConnectionSettings {
+        ConnectionType connectionType = ConnectionType_Multicast;
+        uint16_t serverCommandPort = 0;
+        uint16_t serverDataPort = 0;
+        std::string serverAddress;
+        std::string localAddress;
+        std::string multicastAddress;
+        std::string hostName;
+
+        // The returned params point into this object and are valid as long as it is not modified
+        sNatNetClientConnectParams params() const
+        {
+            sNatNetClientConnectParams params;
+            params.connectionType = connectionType;
+            params.serverCommandPort = serverCommandPort;
+            params.serverDataPort = serverDataPort;
+            params.serverAddress = serverAddress.empty() ? NULL : serverAddress.c_str();
+            params.localAddress = localAddress.empty() ? NULL : localAddress.c_str();
+            params.multicastAddress = multicastAddress.empty() ? NULL : multicastAddress.c_str();
+            return params;
+        }
+
+        bool operator==(const ConnectionSettings& other) const
+        {
+            return connectionType == other.connectionType && serverCommandPort == other.serverCommandPort
+                && serverDataPort == other.serverDataPort && serverAddress == other.serverAddress
+                && localAddress == other.localAddress && multicastAddress == other.multicastAddress;
+        }
+
+        bool operator!=(const ConnectionSettings& other) const { return !(*this == other); }
+
+        // Cache format: one "key value" pair per line
+        bool save(const std::string& path) const
+        {
+            std::ostringstream file;
+            file << "connectionType " << static_cast<int>(connectionType) << "\n"
+                 << "serverCommandPort " << serverCommandPort << "\n"
+                 << "serverDataPort " << serverDataPort << "\n"
+                 << "serverAddress " << serverAddress << "\n"
+                 << "localAddress " << localAddress << "\n"
+                 << "multicastAddress " << multicastAddress << "\n"
+                 << "hostName " << hostName << "\n";
+
+            std::string text = file.str();
+            return detail::replaceFile(path, text.data(), text.size());
+        }
+
+        // Only files of the calling user that nobody else can write are trusted, the cache decides
+        // which server connect() talks to
+        bool load(const std::string& path)
+        {
+            struct stat info;
+            if (lstat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode) || info.st_uid != geteuid() || (info.st_mode & (S_IWGRP | S_IWOTH)))
+                return false;
+
+            std::ifstream file(path);
+            if (!file)
+                return false;
+
+            // Fields are parsed into a copy, a garbled file leaves these settings untouched
+            ConnectionSettings settings;
+            long number;
+            std::string line;
+            while (std::getline(file, line)) {
+                size_t space = line.find(' ');
+                std::string key = line.substr(0, space);
+                std::string value = space == std::string::npos ? std::string() : line.substr(space + 1);
+
+                if (key == "connectionType") {
+                    if (!parseInteger(value, 0, ConnectionType_Unicast, number))
+                        return false;
+                    settings.connectionType = static_cast<ConnectionType>(number);
+                }
+                else if (key == "serverCommandPort" || key == "serverDataPort") {
+                    if (!parseInteger(value, 0, 65535, number))
+                        return false;
+                    (key == "serverCommandPort" ? settings.serverCommandPort : settings.serverDataPort) = static_cast<uint16_t>(number);
+                }
+                else if (key == "serverAddress")
+                    settings.serverAddress = value;
+                else if (key == "localAddress")
+                    settings.localAddress = value;
+                else if (key == "multicastAddress")
+                    settings.multicastAddress = value;
+                else if (key == "hostName")
+                    settings.hostName = value;
+            }
+
+            if (settings.serverAddress.empty())
+                return false;
+            *this = settings;
+            return true;
+        }
+
+        // Whole decimal field within [min, max]
+        static bool parseInteger(const std::string& text, long min, long max, long& value)
+        {
+            char* end;
+            errno = 0;
+            value = std::strtol(text.c_str(), &end, 10);
+            return end != text.c_str() && *end == '\0' && errno == 0 && value >= min && value <= max;
+        }
+
+        static ConnectionSettings fromDiscovered(const sNatNetDiscoveredServer& server)
+        {
+            ConnectionSettings settings;
+            settings.serverCommandPort = server.serverCommandPort;
+            settings.serverAddress = server.serverAddress;
+            settings.localAddress = server.localAddress;
+            settings.hostName = server.serverDescription.szHostComputerName;
+
+            if (server.serverDescription.bConnectionInfoValid) {
+                char multicastAddress[kNatNetIpv4AddrStrLenMax];
+                snprintf(multicastAddress, sizeof multicastAddress,
+                    "%" PRIu8 ".%" PRIu8 ".%" PRIu8 ".%" PRIu8 "",
+                    server.serverDescription.ConnectionMulticastAddress[0],
+                    server.serverDescription.ConnectionMulticastAddress[1],
+                    server.serverDescription.ConnectionMulticastAddress[2],
+                    server.serverDescription.ConnectionMulticastAddress[3]);
+
+                settings.connectionType = server.serverDescription.ConnectionMulticast ? ConnectionType_Multicast : ConnectionType_Unicast;
+                settings.serverDataPort = server.serverDescription.ConnectionDataPort;
+                settings.multicastAddress = multicastAddress;
+            }
+            else {
+                // We're missing some info because it's a legacy server.
+                // Guess the defaults and make a best effort attempt to connect.
+                settings.connectionType = ConnectionType_Multicast;
+                settings.serverDataPort = 0;
+            }
+
+            return settings;
+        }
+    };
+
+    // Selection rules for discovered servers; empty fields match anything
+    struct ServerSelector {
+        std::string hostName;
+        std::string address;
+        int connectionType = -1;
+
+        bool matches(const ConnectionSettings& settings) const
+        {
+            return (hostName.empty() || hostName == settings.hostName)
+                && (address.empty() || address == settings.serverAddress)
+                && (connectionType < 0 || connectionType == settings.connectionType);
+        }
+
+        bool matches(const sNatNetDiscoveredServer& server) const
+        {
+            return matches(ConnectionSettings::fromDiscovered(server));
+        }
+    };
+
+    // Per-user cache file: $XDG_CACHE_HOME, else ~/.cache (created if missing), else a uid-suffixed
+    // name in /tmp, whose owner load() checks
+    inline std::string defaultCachePath()
+    {
+        std::string directory;
+        if (const char* cache = std::getenv("XDG_CACHE_HOME"); cache && *cache)
+            directory = cache;
+        else if (const char* home = std::getenv("HOME"); home && *home) {
+            directory = std::string(home) + "/.cache";
+            mkdir(directory.c_str(), 0700);
+        }
+        else
+            return "/tmp/optitrack_lib_server." + std::to_string(geteuid()) + ".cache";
+
+        return directory + "/optitrack_lib_server.cache";
+    }
+
+    struct DiscoveryOptions {
+        ServerSelector selector;
+
+        // How long a broadcast discovery waits for server replies
+        unsigned int timeoutMillisec = 500;
+
+        // Last good connection parameters; an empty path disables the cache
+        std::string cachePath = defaultCachePath();
+    };
+
+    // Headless broadcast discovery; blocks for at most timeoutMillisec
+    inline std::vector<sNatNetDiscoveredServer> discoverServers(unsigned int timeoutMillisec = 500, int maxServers = 16)
+    {
+        std::vector<sNatNetDiscoveredServer> servers(maxServers);
+        int numServers = maxServers;
+
+        if (NatNet_BroadcastServerDiscovery(servers.data(), &numServers, timeoutMillisec) != ErrorCode_OK)
+            return {};
+
+        servers.resize(std::min(numServers, maxServers));
+        return servers;
+    }
+
+    // First server satisfying the selector
+    inline bool selectServer(const std::vector<sNatNetDiscoveredServer>& servers, const ServerSelector& selector, ConnectionSettings& settings)
+    {
+        for (const auto& server : servers)
+            if (selector.matches(server)) {
+                settings = ConnectionSettings::fromDiscovered(server);
+                return true;
+            }
+
+        return false;
+    }
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_DISCOVERY_HPP
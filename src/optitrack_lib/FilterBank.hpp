@@ -0,0 +1,227 @@
+#ifndef OPTITRACKLIB_FILTERBANK_HPP
+#define OPTITRACKLIB_FILTERBANK_HPP
+
+#include <cmath>
+
+#include <Eigen/Core>
+
+namespace optitrack_lib {
+    enum class FilterType {
+        None,
+        OneEuro, // One Euro position, adaptive SLERP orientation
+        Kalman // constant-velocity Kalman position, adaptive SLERP orientation
+    };
+
+    struct FilterParams {
+        // One Euro (position, m): cutoff = minCutoff + beta * speed
+        float minCutoff = 1.0f;
+        float beta = 0.5f;
+        float derivativeCutoff = 1.0f;
+
+        // Adaptive SLERP (orientation, rad): cutoff = rotationMinCutoff + rotationBeta * angular speed
+        float rotationMinCutoff = 1.0f;
+        float rotationBeta = 0.5f;
+
+        // Constant-velocity Kalman: acceleration spectral density (m^2/s^3) and measurement variance (m^2)
+        float processNoise = 10.0f;
+        float measurementNoise = 1e-6f;
+    };
+
+    // Filters for all bodies at once. Poses are stored structure-of-arrays (one contiguous column per
+    // x, y, z, qx, qy, qz, qw) so that every step is an Eigen array expression vectorized across bodies.
+    // Parameters are per body.
+    class FilterBank {
+    public:
+        using Array = Eigen::Array<float, Eigen::Dynamic, 1>;
+        using Mask = Eigen::Array<bool, Eigen::Dynamic, 1>;
+        using Poses = Eigen::Array<float, Eigen::Dynamic, 7>;
+
+        FilterBank(FilterType type = FilterType::OneEuro) : _type(type) {}
+
+        FilterType type() const { return _type; }
+
+        size_t size() const { return _poses.rows(); }
+
+        // New bodies start with the default parameters and uninitialized state
+        void resize(Eigen::Index n)
+        {
+            Eigen::Index old = _poses.rows();
+            if (n <= old)
+                return;
+
+            _poses.conservativeResize(n, 7);
+            _velocity.conservativeResize(n, 3);
+            _covariance.conservativeResize(n, 3);
+            _speed.conservativeResize(n);
+            _angularSpeed.conservativeResize(n);
+            _initialized.conservativeResize(n);
+            _minCutoff.conservativeResize(n);
+            _beta.conservativeResize(n);
+            _derivativeCutoff.conservativeResize(n);
+            _rotationMinCutoff.conservativeResize(n);
+            _rotationBeta.conservativeResize(n);
+            _processNoise.conservativeResize(n);
+            _measurementNoise.conservativeResize(n);
+
+            for (Eigen::Index i = old; i < n; i++) {
+                _poses.row(i) << 0, 0, 0, 0, 0, 0, 1;
+                _initialized(i) = false;
+                setParams(i, _defaults);
+            }
+            _velocity.bottomRows(n - old).setZero();
+            _covariance.bottomRows(n - old).setZero();
+            _speed.tail(n - old).setZero();
+            _angularSpeed.tail(n - old).setZero();
+        }
+
+        void setParams(const FilterParams& params)
+        {
+            _defaults = params;
+            for (Eigen::Index i = 0; i < _poses.rows(); i++)
+                setParams(i, params);
+        }
+
+        void setParams(Eigen::Index i, const FilterParams& params)
+        {
+            _minCutoff(i) = params.minCutoff;
+            _beta(i) = params.beta;
+            _derivativeCutoff(i) = params.derivativeCutoff;
+            _rotationMinCutoff(i) = params.rotationMinCutoff;
+            _rotationBeta(i) = params.rotationBeta;
+            _processNoise(i) = params.processNoise;
+            _measurementNoise(i) = params.measurementNoise;
+        }
+
+        // Filtered poses, one row per body
+        const Poses& poses() const { return _poses; }
+
+        // Feed one frame: measurements for all bodies, which of them are valid, and the time (s) since each body's
+        // previous measurement. Bodies without a valid measurement keep their state.
+        void update(const Poses& measurements, const Mask& valid, const Array& dt)
+        {
+            resize(measurements.rows());
+            Eigen::Index n = measurements.rows();
+
+            // First valid sample initializes the body
+            Mask fresh = valid && !_initialized.head(n);
+            Mask active = valid && _initialized.head(n);
+            _initialized.head(n) = _initialized.head(n) || valid;
+
+            Array safeDt = dt.max(1e-5f);
+
+            if (_type == FilterType::OneEuro)
+                oneEuro(measurements, active, safeDt);
+            else if (_type == FilterType::Kalman)
+                kalman(measurements, active, safeDt);
+
+            if (_type != FilterType::None)
+                slerp(measurements, active, safeDt);
+            else
+                for (int c = 0; c < 7; c++)
+                    _poses.col(c).head(n) = valid.select(measurements.col(c), _poses.col(c).head(n));
+
+            for (int c = 0; c < 7; c++)
+                _poses.col(c).head(n) = fresh.select(measurements.col(c), _poses.col(c).head(n));
+        }
+
+    protected:
+        FilterType _type;
+        FilterParams _defaults;
+
+        Poses _poses;
+        Eigen::Array<float, Eigen::Dynamic, 3> _velocity; // smoothed derivative (One Euro) or velocity state (Kalman)
+        Eigen::Array<float, Eigen::Dynamic, 3> _covariance; // Kalman P00, P01, P11, shared by the three axes
+        Array _speed, _angularSpeed;
+        Mask _initialized;
+
+        Array _minCutoff, _beta, _derivativeCutoff, _rotationMinCutoff, _rotationBeta, _processNoise, _measurementNoise;
+
+        // Exponential smoothing factor for a first order low-pass with the given cutoff (Hz)
+        static Array alpha(const Array& cutoff, const Array& dt)
+        {
+            return 1.0f / (1.0f + 1.0f / (2.0f * float(M_PI) * cutoff * dt));
+        }
+
+        void oneEuro(const Poses& z, const Mask& active, const Array& dt)
+        {
+            Eigen::Index n = z.rows();
+            Array derivativeAlpha = alpha(_derivativeCutoff.head(n), dt);
+
+            Array speed2 = Array::Zero(n);
+            for (int c = 0; c < 3; c++) {
+                Array derivative = (z.col(c) - _poses.col(c).head(n)) / dt;
+                Array smoothed = _velocity.col(c).head(n) + derivativeAlpha * (derivative - _velocity.col(c).head(n));
+                _velocity.col(c).head(n) = active.select(smoothed, _velocity.col(c).head(n));
+                speed2 += _velocity.col(c).head(n).square();
+            }
+
+            Array positionAlpha = alpha(_minCutoff.head(n) + _beta.head(n) * speed2.sqrt(), dt);
+            for (int c = 0; c < 3; c++) {
+                Array filtered = _poses.col(c).head(n) + positionAlpha * (z.col(c) - _poses.col(c).head(n));
+                _poses.col(c).head(n) = active.select(filtered, _poses.col(c).head(n));
+            }
+        }
+
+        void kalman(const Poses& z, const Mask& active, const Array& dt)
+        {
+            Eigen::Index n = z.rows();
+            auto P00 = _covariance.col(0).head(n), P01 = _covariance.col(1).head(n), P11 = _covariance.col(2).head(n);
+            Array q = _processNoise.head(n);
+
+            // Predict
+            Array p00 = P00 + dt * (2.0f * P01 + dt * P11) + q * dt.cube() / 3.0f;
+            Array p01 = P01 + dt * P11 + q * dt.square() / 2.0f;
+            Array p11 = P11 + q * dt;
+
+            // Update (gain shared by the three axes since they have the same noise model)
+            Array gain0 = p00 / (p00 + _measurementNoise.head(n));
+            Array gain1 = p01 / (p00 + _measurementNoise.head(n));
+
+            for (int c = 0; c < 3; c++) {
+                Array predicted = _poses.col(c).head(n) + _velocity.col(c).head(n) * dt;
+                Array innovation = z.col(c) - predicted;
+                _poses.col(c).head(n) = active.select(predicted + gain0 * innovation, _poses.col(c).head(n));
+                _velocity.col(c).head(n) = active.select(_velocity.col(c).head(n) + gain1 * innovation, _velocity.col(c).head(n));
+            }
+
+            P11 = active.select(p11 - gain1 * p01, P11);
+            P01 = active.select((1.0f - gain0) * p01, P01);
+            P00 = active.select((1.0f - gain0) * p00, P00);
+        }
+
+        // Orientation: SLERP towards the measurement with a One Euro style adaptive factor
+        void slerp(const Poses& z, const Mask& active, const Array& dt)
+        {
+            Eigen::Index n = z.rows();
+            auto qx = _poses.col(3).head(n), qy = _poses.col(4).head(n), qz = _poses.col(5).head(n), qw = _poses.col(6).head(n);
+
+            Array dot = qx * z.col(3) + qy * z.col(4) + qz * z.col(5) + qw * z.col(6);
+
+            // Take the shortest path
+            Array sign = (dot < 0).select(Array::Constant(n, -1.0f), Array::Constant(n, 1.0f));
+            Array cosine = (dot * sign).min(1.0f);
+            Array theta = cosine.acos();
+
+            Array rate = 2.0f * theta / dt;
+            Array derivativeAlpha = alpha(_derivativeCutoff.head(n), dt);
+            _angularSpeed.head(n) = active.select(_angularSpeed.head(n) + derivativeAlpha * (rate - _angularSpeed.head(n)), _angularSpeed.head(n));
+            Array t = alpha(_rotationMinCutoff.head(n) + _rotationBeta.head(n) * _angularSpeed.head(n), dt);
+
+            // Fall back to linear interpolation when the angle is tiny
+            Array sine = theta.sin();
+            Mask small = sine < 1e-4f;
+            Array w0 = small.select(1.0f - t, ((1.0f - t) * theta).sin() / sine);
+            Array w1 = small.select(t, (t * theta).sin() / sine) * sign;
+
+            Array x = w0 * qx + w1 * z.col(3), y = w0 * qy + w1 * z.col(4), zz = w0 * qz + w1 * z.col(5), w = w0 * qw + w1 * z.col(6);
+            Array norm = (x.square() + y.square() + zz.square() + w.square()).rsqrt();
+
+            qx = active.select(x * norm, qx);
+            qy = active.select(y * norm, qy);
+            qz = active.select(zz * norm, qz);
+            qw = active.select(w * norm, qw);
+        }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_FILTERBANK_HPP
@@ -0,0 +1,169 @@
+#ifndef OPTITRACKLIB_GATING_HPP
+#define OPTITRACKLIB_GATING_HPP
+
+#include <cstdint>
+
+#include <Eigen/Core>
+
+namespace optitrack_lib {
+    enum SampleStatus : uint8_t {
+        SampleValid = 0,
+        SampleInvalid = 1, // not tracked, not in the frame, or mean marker error above threshold
+        SampleOutlier = 2 // tracked but inconsistent with the recent motion
+    };
+
+    struct GateParams {
+        float maxMeanError = 0.01f; // m
+        float maxSpeed = 20.0f; // m/s
+        float maxAcceleration = 1000.0f; // m/s^2
+        float maxAngularSpeed = 100.0f; // rad/s
+
+        // After this many consecutive outliers the body is assumed to have really moved and is re-acquired
+        uint32_t reacquireAfter = 10;
+    };
+
+    struct DropoutStats {
+        uint64_t samples = 0;
+        uint64_t invalid = 0;
+        uint64_t outliers = 0;
+        uint32_t currentRun = 0; // consecutive rejected samples up to now
+        uint32_t longestRun = 0;
+
+        double ratio() const { return samples ? double(invalid + outliers) / samples : 0; }
+    };
+
+    // Validity gating of all bodies in one branch-free pass over structure-of-arrays data
+    class GateBank {
+    public:
+        using Array = Eigen::Array<float, Eigen::Dynamic, 1>;
+        using Mask = Eigen::Array<bool, Eigen::Dynamic, 1>;
+        using Poses = Eigen::Array<float, Eigen::Dynamic, 7>;
+        using Status = Eigen::Array<uint8_t, Eigen::Dynamic, 1>;
+        using Counter = Eigen::Array<uint64_t, Eigen::Dynamic, 1>;
+        using Run = Eigen::Array<uint32_t, Eigen::Dynamic, 1>;
+
+        size_t size() const { return _status.rows(); }
+
+        void resize(Eigen::Index n)
+        {
+            Eigen::Index old = _status.rows();
+            if (n <= old)
+                return;
+
+            _last.conservativeResize(n, 7);
+            _velocity.conservativeResize(n, 3);
+            _initialized.conservativeResize(n);
+            _status.conservativeResize(n);
+            _samples.conservativeResize(n);
+            _invalid.conservativeResize(n);
+            _outliers.conservativeResize(n);
+            _currentRun.conservativeResize(n);
+            _longestRun.conservativeResize(n);
+            _maxMeanError.conservativeResize(n);
+            _maxSpeed.conservativeResize(n);
+            _maxAcceleration.conservativeResize(n);
+            _maxAngularSpeed.conservativeResize(n);
+            _reacquireAfter.conservativeResize(n);
+
+            Eigen::Index added = n - old;
+            _last.bottomRows(added).setZero();
+            _velocity.bottomRows(added).setZero();
+            _initialized.tail(added).setConstant(false);
+            _status.tail(added).setConstant(SampleInvalid);
+            _samples.tail(added).setZero();
+            _invalid.tail(added).setZero();
+            _outliers.tail(added).setZero();
+            _currentRun.tail(added).setZero();
+            _longestRun.tail(added).setZero();
+
+            for (Eigen::Index i = old; i < n; i++)
+                setParams(i, _defaults);
+        }
+
+        void setParams(const GateParams& params)
+        {
+            _defaults = params;
+            for (Eigen::Index i = 0; i < _status.rows(); i++)
+                setParams(i, params);
+        }
+
+        void setParams(Eigen::Index i, const GateParams& params)
+        {
+            _maxMeanError(i) = params.maxMeanError;
+            _maxSpeed(i) = params.maxSpeed;
+            _maxAcceleration(i) = params.maxAcceleration;
+            _maxAngularSpeed(i) = params.maxAngularSpeed;
+            _reacquireAfter(i) = params.reacquireAfter;
+        }
+
+        // Status of the last update, one entry per body
+        const Status& status() const { return _status; }
+
+        DropoutStats stats(Eigen::Index i) const
+        {
+            DropoutStats stats;
+            stats.samples = _samples(i);
+            stats.invalid = _invalid(i);
+            stats.outliers = _outliers(i);
+            stats.currentRun = _currentRun(i);
+            stats.longestRun = _longestRun(i);
+            return stats;
+        }
+
+        // tracked: body present with params bit 0 set; dt: seconds since the body's last accepted sample
+        const Status& update(const Poses& z, const Mask& tracked, const Array& meanError, const Array& dt)
+        {
+            resize(z.rows());
+            Eigen::Index n = z.rows();
+            Array safeDt = dt.max(1e-5f);
+
+            Mask measurable = tracked && meanError <= _maxMeanError.head(n);
+
+            // Jump tests against the last accepted sample
+            Eigen::Array<float, Eigen::Dynamic, 3> velocity = (z.leftCols<3>() - _last.leftCols<3>().topRows(n)).colwise() / safeDt;
+            Array speed = velocity.square().rowwise().sum().sqrt();
+            Array acceleration = (velocity - _velocity.topRows(n)).square().rowwise().sum().sqrt() / safeDt;
+
+            Array dot = (z.rightCols<4>() * _last.rightCols<4>().topRows(n)).rowwise().sum().abs().min(1.0f);
+            Array angularSpeed = 2.0f * dot.acos() / safeDt;
+
+            Mask consistent = speed <= _maxSpeed.head(n) && acceleration <= _maxAcceleration.head(n) && angularSpeed <= _maxAngularSpeed.head(n);
+
+            // Bodies without history, or stuck in outliers for too long, are (re)acquired as they are
+            Mask reacquire = !_initialized.head(n) || _currentRun.head(n) >= _reacquireAfter.head(n);
+            Mask accepted = measurable && (consistent || reacquire);
+
+            _status.head(n) = measurable.select(accepted.select(Status::Constant(n, SampleValid), uint8_t(SampleOutlier)), uint8_t(SampleInvalid));
+
+            // Accepted samples become the new reference; velocity restarts from zero on (re)acquisition
+            for (int c = 0; c < 7; c++)
+                _last.col(c).head(n) = accepted.select(z.col(c), _last.col(c).head(n));
+            for (int c = 0; c < 3; c++)
+                _velocity.col(c).head(n) = accepted.select(reacquire.select(0.0f, velocity.col(c)), _velocity.col(c).head(n));
+            _initialized.head(n) = _initialized.head(n) || accepted;
+
+            // Dropout statistics
+            _samples.head(n) += 1;
+            _invalid.head(n) += (_status.head(n) == uint8_t(SampleInvalid)).cast<uint64_t>();
+            _outliers.head(n) += (_status.head(n) == uint8_t(SampleOutlier)).cast<uint64_t>();
+            _currentRun.head(n) = accepted.select(Run::Zero(n), _currentRun.head(n) + 1);
+            _longestRun.head(n) = _longestRun.head(n).max(_currentRun.head(n));
+
+            return _status;
+        }
+
+    protected:
+        GateParams _defaults;
+
+        Poses _last;
+        Eigen::Array<float, Eigen::Dynamic, 3> _velocity;
+        Mask _initialized;
+        Status _status;
+
+        Counter _samples, _invalid, _outliers;
+        Run _currentRun, _longestRun, _reacquireAfter;
+        Array _maxMeanError, _maxSpeed, _maxAcceleration, _maxAngularSpeed;
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_GATING_HPP
@@ -0,0 +1,271 @@
+#ifndef OPTITRACKLIB_JITTERBUFFER_HPP
+#define OPTITRACKLIB_JITTERBUFFER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace optitrack_lib {
+    struct JitterBufferOptions {
+        // Fraction of the frames that should arrive before their playout time: the delay follows this
+        // quantile of the transit jitter, higher is smoother and later
+        double quantile = 0.95;
+
+        // Bounds of the added delay, seconds
+        double minDelay = 0;
+        double maxDelay = 0.05;
+
+        // Frames of transit history the delay is estimated on
+        size_t window = 256;
+
+        // Largest change of one playout interval while the delay adapts, as a fraction of the source
+        // interval, so that adapting does not itself add jitter
+        double adaptation = 0.05;
+
+        // Frames held at most; further frames are discarded until the playout catches up
+        size_t capacity = 32;
+    };
+
+    struct JitterBufferStats {
+        size_t depth = 0; // frames waiting for their playout time
+        double delay = 0; // s, current delay beyond the fastest transit
+        uint64_t released = 0;
+        uint64_t late = 0; // arrived after their playout time
+        uint64_t reordered = 0; // arrived after a newer frame and put back in order
+        uint64_t discarded = 0; // too late to reorder, duplicates or buffer full
+    };
+
+    // Adaptive playout buffer: frames come in from one writer thread in bursts and possibly out of
+    // order, and are released in frame number order, each at its source (exposure) time plus a
+    // constant offset, so that release intervals match the source intervals. The offset is the
+    // fastest transit (arrival - source time) over the window plus the delay, the jitter quantile, so
+    // the clocks need not be synchronized. Frames live in preallocated slots: the writer fills the
+    // slot it acquired, the release callback runs on the playout thread and may swap the frame out.
+    template <typename T>
+    class JitterBuffer {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using Release = std::function<void(T&)>;
+
+        JitterBuffer(const JitterBufferOptions& options, Release release)
+            : _options(options), _release(std::move(release))
+        {
+            _options.capacity = std::max<size_t>(_options.capacity, 1);
+            _options.window = std::max<size_t>(_options.window, 1);
+            _slots.resize(_options.capacity);
+            for (size_t i = _options.capacity; i-- > 0;)
+                _free.push_back(static_cast<uint32_t>(i));
+            _queue.reserve(_options.capacity);
+            _transit.reserve(_options.window);
+            _scratch.reserve(_options.window);
+
+            _thread = std::thread(&JitterBuffer::run, this);
+        }
+
+        ~JitterBuffer()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _condition.notify_one();
+            _thread.join();
+        }
+
+        const JitterBufferOptions& options() const { return _options; }
+
+        // Writer: slot for the next frame, nullptr when the buffer is full (the frame is discarded)
+        T* acquire()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_free.empty()) {
+                _stats.discarded++;
+                return nullptr;
+            }
+
+            T* slot = &_slots[_free.back()];
+            _free.pop_back();
+            return slot;
+        }
+
+        // Writer: queue the slot filled after acquire(). number orders the frames, source is their
+        // exposure time in seconds on the sender's clock.
+        void push(T* slot, int64_t number, double source, Clock::time_point arrival)
+        {
+            uint32_t index = static_cast<uint32_t>(slot - _slots.data());
+            double arrived = seconds(arrival);
+            bool front;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+
+                // Frame numbers far behind the newest one are a restarted stream (Motive restart, another
+                // take), not a late frame
+                if (_receivedAny && number + static_cast<int64_t>(_options.capacity) < _highest)
+                    clear();
+
+                auto position = std::upper_bound(_queue.begin(), _queue.end(), number, [](int64_t n, const Entry& e) { return n < e.number; });
+                bool duplicate = position != _queue.begin() && (position - 1)->number == number;
+                if ((_releasedAny && number <= _lastReleased) || duplicate) {
+                    _stats.late += !duplicate;
+                    _stats.discarded++;
+                    _free.push_back(index);
+                    return;
+                }
+
+                if (_receivedAny && number < _highest)
+                    _stats.reordered++;
+                else {
+                    adapt(arrived - source, source - _lastSource);
+                    _lastSource = source;
+                    _highest = number;
+                }
+                _receivedAny = true;
+
+                double playout = source + _offset;
+                _stats.late += arrived > playout;
+                front = position == _queue.begin();
+                _queue.insert(position, {number, playout, index});
+                _stats.depth = _queue.size();
+            }
+
+            if (front)
+                _condition.notify_one();
+        }
+
+        // Start over with a new stream, e.g. after a reconnect: queued frames are discarded and the frame
+        // ordering and transit window forgotten
+        void reset()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            clear();
+        }
+
+        JitterBufferStats stats()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _stats;
+        }
+
+        std::thread& thread() { return _thread; }
+
+    protected:
+        struct Entry {
+            int64_t number;
+            double playout; // local steady_clock seconds
+            uint32_t slot;
+        };
+
+        static double seconds(Clock::time_point time) { return std::chrono::duration<double>(time.time_since_epoch()).count(); }
+
+        static Clock::time_point timePoint(double seconds)
+        {
+            return Clock::time_point(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds)));
+        }
+
+        // Call with _mutex held
+        void clear()
+        {
+            for (const Entry& entry : _queue)
+                _free.push_back(entry.slot);
+            _stats.discarded += _queue.size();
+            _queue.clear();
+            _stats.depth = 0;
+
+            _transit.clear();
+            _transitCount = 0;
+            _highest = _lastReleased = 0;
+            _receivedAny = _releasedAny = false;
+        }
+
+        // New in-order transit sample: the offset moves towards fastest transit + delay, by at most
+        // adaptation x the source interval per frame. Call with _mutex held.
+        void adapt(double transit, double interval)
+        {
+            // A new source clock (reconnect, another server) starts a new window
+            if (_transitCount && std::abs(transit - _offset) > 1.0) {
+                _transit.clear();
+                _transitCount = 0;
+            }
+
+            if (_transit.size() < _options.window)
+                _transit.push_back(transit);
+            else
+                _transit[_transitCount % _options.window] = transit;
+            _transitCount++;
+
+            _scratch.assign(_transit.begin(), _transit.end());
+            auto quantile = _scratch.begin() + static_cast<std::ptrdiff_t>(std::min(_options.quantile, 1.0) * (_scratch.size() - 1));
+            std::nth_element(_scratch.begin(), quantile, _scratch.end());
+            double fastest = *std::min_element(_scratch.begin(), quantile + 1);
+            double target = fastest + std::min(std::max(*quantile - fastest, _options.minDelay), _options.maxDelay);
+
+            if (_transitCount == 1)
+                _offset = target;
+            else {
+                double step = _options.adaptation * std::max(interval, 0.0);
+                _offset += std::min(std::max(target - _offset, -step), step);
+            }
+            _stats.delay = _offset - fastest;
+        }
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (!_stop) {
+                if (_queue.empty()) {
+                    _condition.wait(lock);
+                    continue;
+                }
+
+                // Woken early by a new head or stop, then the deadline is re-evaluated
+                Clock::time_point deadline = timePoint(_queue.front().playout);
+                if (Clock::now() < deadline) {
+                    _condition.wait_until(lock, deadline);
+                    continue;
+                }
+
+                Entry entry = _queue.front();
+                _queue.erase(_queue.begin());
+                _lastReleased = entry.number;
+                _releasedAny = true;
+                _stats.depth = _queue.size();
+
+                lock.unlock();
+                _release(_slots[entry.slot]);
+                lock.lock();
+
+                _free.push_back(entry.slot);
+                _stats.released++;
+            }
+        }
+
+        JitterBufferOptions _options;
+        Release _release;
+
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        bool _stop = false;
+
+        std::vector<T> _slots;
+        std::vector<uint32_t> _free;
+        std::vector<Entry> _queue; // by frame number
+
+        // Transit window and playout offset (local - source seconds)
+        std::vector<double> _transit, _scratch;
+        uint64_t _transitCount = 0;
+        double _offset = 0, _lastSource = 0;
+        int64_t _highest = 0, _lastReleased = 0;
+        bool _receivedAny = false, _releasedAny = false;
+
+        JitterBufferStats _stats;
+        std::thread _thread;
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_JITTERBUFFER_HPP
@@ -0,0 +1,363 @@
+#ifndef OPTITRACKLIB_LOG_HPP
+#define OPTITRACKLIB_LOG_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <syslog.h>
+
+namespace optitrack_lib {
+    enum LogLevel : uint8_t {
+        LogDebug = 0,
+        LogInfo,
+        LogWarning,
+        LogError,
+        LogOff
+    };
+
+    inline const char* levelName(LogLevel level)
+    {
+        static const char* names[] = {"DEBUG", "INFO", "WARN", "ERROR", "OFF"};
+        return names[level < LogOff ? level : LogOff];
+    }
+
+    // One message, formatted at the call site into a fixed buffer (longer messages are truncated)
+    struct LogRecord {
+        static constexpr size_t kMessageSize = 256;
+
+        LogLevel level;
+        std::chrono::system_clock::time_point time;
+        const char* file;
+        int line;
+        uint32_t suppressed; // messages of the same call site dropped by the rate limit just before this one
+        char message[kMessageSize];
+    };
+
+    // Destination of the writer thread; write() is only ever called from that thread
+    class LogSink {
+    public:
+        virtual ~LogSink() = default;
+
+        // line is the fully formatted record, newline terminated
+        virtual void write(const LogRecord& record, const char* line) = 0;
+
+        // Called when the queue runs empty
+        virtual void flush() {}
+    };
+
+    class StderrSink : public LogSink {
+    public:
+        void write(const LogRecord&, const char* line) override { std::fputs(line, stderr); }
+
+        void flush() override { std::fflush(stderr); }
+    };
+
+    class FileSink : public LogSink {
+    public:
+        FileSink(const std::string& path) : _file(std::fopen(path.c_str(), "a")) {}
+
+        ~FileSink() override
+        {
+            if (_file)
+                std::fclose(_file);
+        }
+
+        bool open() const { return _file != nullptr; }
+
+        void write(const LogRecord&, const char* line) override
+        {
+            if (_file)
+                std::fputs(line, _file);
+        }
+
+        void flush() override
+        {
+            if (_file)
+                std::fflush(_file);
+        }
+
+    protected:
+        FILE* _file;
+    };
+
+    class SyslogSink : public LogSink {
+    public:
+        SyslogSink(const char* ident = "optitrack") { openlog(ident, LOG_PID, LOG_USER); }
+
+        ~SyslogSink() override { closelog(); }
+
+        // syslog adds its own timestamp, only the message is sent
+        void write(const LogRecord& record, const char*) override
+        {
+            static const int priorities[] = {LOG_DEBUG, LOG_INFO, LOG_WARNING, LOG_ERR};
+            if (record.suppressed)
+                syslog(priorities[record.level], "%s (%u similar messages suppressed)", record.message, record.suppressed);
+            else
+                syslog(priorities[record.level], "%s", record.message);
+        }
+    };
+
+    // Rate limit state of one call site
+    struct LogSite {
+        std::atomic<int64_t> window{0};
+        std::atomic<uint32_t> count{0}, suppressed{0};
+    };
+
+    // Process-wide asynchronous logger. Callers format into a slot of a bounded lock-free MPSC queue
+    // (Vyukov) and return: no lock, no allocation, no syscall, which matters on the NatNet receive
+    // thread. A writer thread, started with the logger, polls the queue and hands the records to the
+    // sinks. When the queue is full the message is dropped and counted.
+    class Logger {
+    public:
+        static Logger& instance()
+        {
+            static Logger logger;
+            return logger;
+        }
+
+        ~Logger() { stop(); }
+
+        void setLevel(LogLevel level) { _level.store(level, std::memory_order_relaxed); }
+
+        LogLevel level() const { return _level.load(std::memory_order_relaxed); }
+
+        bool enabled(LogLevel level) const { return level >= _level.load(std::memory_order_relaxed); }
+
+        // Messages per second and call site before suppression; 0 disables the limit
+        void setRateLimit(uint32_t messagesPerSecond) { _rateLimit.store(messagesPerSecond, std::memory_order_relaxed); }
+
+        // Sinks replace the default stderr sink
+        void addSink(std::shared_ptr<LogSink> sink)
+        {
+            std::lock_guard<std::mutex> lock(_sinkMutex);
+            if (!_customSinks)
+                _sinks.clear();
+            _customSinks = true;
+            _sinks.push_back(std::move(sink));
+        }
+
+        void clearSinks()
+        {
+            std::lock_guard<std::mutex> lock(_sinkMutex);
+            _sinks.clear();
+            _customSinks = true;
+        }
+
+        uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+        void log(LogLevel level, LogSite& site, const char* file, int line, const char* format, ...)
+#if defined(__GNUC__)
+            __attribute__((format(printf, 6, 7)))
+#endif
+        {
+            uint32_t suppressed = 0;
+            if (!admit(site, suppressed))
+                return;
+
+            uint64_t position = _enqueue.load(std::memory_order_relaxed);
+            Cell* cell;
+            while (true) {
+                cell = &_cells[position & kMask];
+                uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+                int64_t difference = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+                if (difference == 0) {
+                    if (_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (difference < 0) {
+                    _dropped.fetch_add(1, std::memory_order_relaxed);
+                    site.suppressed.fetch_add(suppressed, std::memory_order_relaxed);
+                    return;
+                }
+                else
+                    position = _enqueue.load(std::memory_order_relaxed);
+            }
+
+            LogRecord& record = cell->record;
+            record.level = level;
+            record.time = std::chrono::system_clock::now();
+            record.file = file;
+            record.line = line;
+            record.suppressed = suppressed;
+
+            va_list args;
+            va_start(args, format);
+            std::vsnprintf(record.message, LogRecord::kMessageSize, format, args);
+            va_end(args);
+
+            cell->sequence.store(position + 1, std::memory_order_release);
+        }
+
+        // Block until everything logged so far has reached the sinks (not for the receive thread)
+        void flush()
+        {
+            uint64_t target = _enqueue.load(std::memory_order_acquire);
+            while (_running.load() && _dequeue.load(std::memory_order_acquire) < target)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            std::lock_guard<std::mutex> lock(_sinkMutex);
+            for (auto& sink : _sinks)
+                sink->flush();
+        }
+
+        void stop()
+        {
+            _stop = true;
+            if (_writer.joinable())
+                _writer.join();
+            _running = false;
+        }
+
+    protected:
+        static constexpr size_t kCapacity = 1024;
+        static constexpr size_t kMask = kCapacity - 1;
+
+        struct Cell {
+            std::atomic<uint64_t> sequence;
+            LogRecord record;
+        };
+
+        Logger() : _cells(new Cell[kCapacity])
+        {
+            for (size_t i = 0; i < kCapacity; i++)
+                _cells[i].sequence.store(i, std::memory_order_relaxed);
+            _sinks.push_back(std::make_shared<StderrSink>());
+            _running = true;
+            _writer = std::thread([this]() { run(); });
+        }
+
+        std::unique_ptr<Cell[]> _cells;
+        alignas(64) std::atomic<uint64_t> _enqueue{0};
+        alignas(64) std::atomic<uint64_t> _dequeue{0};
+        std::atomic<uint64_t> _dropped{0};
+
+        std::atomic<LogLevel> _level{LogInfo};
+        std::atomic<uint32_t> _rateLimit{10};
+
+        std::mutex _sinkMutex;
+        std::vector<std::shared_ptr<LogSink>> _sinks;
+        bool _customSinks = false;
+
+        std::atomic<bool> _running{false}, _stop{false};
+        std::thread _writer;
+
+        // Fixed one second windows per call site; the first message after a suppressed burst carries
+        // the number of messages suppressed
+        bool admit(LogSite& site, uint32_t& suppressed)
+        {
+            uint32_t limit = _rateLimit.load(std::memory_order_relaxed);
+            if (!limit)
+                return true;
+
+            int64_t window = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            int64_t current = site.window.load(std::memory_order_relaxed);
+            if (current != window && site.window.compare_exchange_strong(current, window, std::memory_order_relaxed))
+                site.count.store(0, std::memory_order_relaxed);
+
+            if (site.count.fetch_add(1, std::memory_order_relaxed) >= limit) {
+                site.suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+
+        void run()
+        {
+            char line[LogRecord::kMessageSize + 128];
+            uint64_t reportedDrops = 0;
+
+            while (true) {
+                bool stopping = _stop.load();
+                bool wrote = false;
+                {
+                    std::lock_guard<std::mutex> lock(_sinkMutex);
+
+                    uint64_t position = _dequeue.load(std::memory_order_relaxed);
+                    while (true) {
+                        Cell& cell = _cells[position & kMask];
+                        if (cell.sequence.load(std::memory_order_acquire) != position + 1)
+                            break;
+
+                        format(cell.record, line, sizeof(line));
+                        for (auto& sink : _sinks)
+                            sink->write(cell.record, line);
+
+                        cell.sequence.store(position + kCapacity, std::memory_order_release);
+                        _dequeue.store(++position, std::memory_order_release);
+                        wrote = true;
+                    }
+
+                    uint64_t drops = _dropped.load(std::memory_order_relaxed);
+                    if (drops != reportedDrops) {
+                        LogRecord notice{LogWarning, std::chrono::system_clock::now(), __FILE__, __LINE__, 0, {}};
+                        std::snprintf(notice.message, LogRecord::kMessageSize, "%llu log messages dropped, queue full", static_cast<unsigned long long>(drops - reportedDrops));
+                        format(notice, line, sizeof(line));
+                        for (auto& sink : _sinks)
+                            sink->write(notice, line);
+                        reportedDrops = drops;
+                        wrote = true;
+                    }
+
+                    if (wrote)
+                        for (auto& sink : _sinks)
+                            sink->flush();
+                }
+
+                if (!wrote) {
+                    if (stopping)
+                        return;
+                    // Producers never signal (that would be a syscall), the writer polls
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                }
+            }
+        }
+
+        static void format(const LogRecord& record, char* line, size_t size)
+        {
+            std::time_t seconds = std::chrono::system_clock::to_time_t(record.time);
+            int millisec = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch()).count() % 1000);
+            std::tm local;
+            localtime_r(&seconds, &local);
+
+            char time[32];
+            std::strftime(time, sizeof(time), "%Y-%m-%d %H:%M:%S", &local);
+
+            if (record.suppressed)
+                std::snprintf(line, size, "%s.%03d [%s] %s (%u similar messages suppressed)\n", time, millisec, levelName(record.level), record.message, record.suppressed);
+            else
+                std::snprintf(line, size, "%s.%03d [%s] %s\n", time, millisec, levelName(record.level), record.message);
+        }
+    };
+} // namespace optitrack_lib
+
+// Messages below this level are compiled out
+#ifndef OPTITRACK_LOG_LEVEL
+#define OPTITRACK_LOG_LEVEL 0
+#endif
+
+// printf-style logging; the level is checked before any formatting, each call site is rate limited
+#define OPTITRACK_LOG(level, ...)                                                                                \
+    do {                                                                                                         \
+        if ((level) >= OPTITRACK_LOG_LEVEL && ::optitrack_lib::Logger::instance().enabled(level)) {              \
+            static ::optitrack_lib::LogSite _logSite;                                                            \
+            ::optitrack_lib::Logger::instance().log(level, _logSite, __FILE__, __LINE__, __VA_ARGS__);           \
+        }                                                                                                        \
+    } while (0)
+
+#define OPTITRACK_LOG_DEBUG(...) OPTITRACK_LOG(::optitrack_lib::LogDebug, __VA_ARGS__)
+#define OPTITRACK_LOG_INFO(...) OPTITRACK_LOG(::optitrack_lib::LogInfo, __VA_ARGS__)
+#define OPTITRACK_LOG_WARN(...) OPTITRACK_LOG(::optitrack_lib::LogWarning, __VA_ARGS__)
+#define OPTITRACK_LOG_ERROR(...) OPTITRACK_LOG(::optitrack_lib::LogError, __VA_ARGS__)
+
+#endif // OPTITRACKLIB_LOG_HPP
@@ -0,0 +1,334 @@
+#ifndef OPTITRACKLIB_MARKERSOLVER_HPP
+#define OPTITRACKLIB_MARKERSOLVER_HPP
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <NatNet/NatNetTypes.h>
+
+#include "optitrack_lib/Log.hpp"
+
+namespace optitrack_lib {
+    // Composite labeled marker ID: asset (e.g. rigid body streaming ID) in the high 16 bits, 1-based
+    // marker index within the asset in the low 16 bits (as NatNet_DecodeID splits it)
+    inline int32_t markerId(int32_t asset, int32_t member) { return (asset << 16) | (member & 0xFFFF); }
+
+    // Markers of a client-side body: labeled marker ID and position in the body frame, with weights
+    struct MarkerTemplate {
+        std::string name;
+        std::vector<int32_t> markerIds;
+        std::vector<Eigen::Vector3d> positions;
+        std::vector<double> weights; // empty: all 1
+
+        // Markers of a Motive rigid body as streamed under its ID; name defaults to the asset's
+        static MarkerTemplate fromDescription(const sRigidBodyDescription& description, const std::string& name = "")
+        {
+            MarkerTemplate body;
+            body.name = name.empty() ? description.szName : name;
+            for (int32_t i = 0; i < description.nMarkers; i++) {
+                body.markerIds.push_back(markerId(description.ID, i + 1));
+                body.positions.emplace_back(description.MarkerPositions[i][0], description.MarkerPositions[i][1], description.MarkerPositions[i][2]);
+            }
+            return body;
+        }
+    };
+
+    struct SolverParams {
+        double rejectResidual = 0.005; // m, the worst marker beyond this is dropped and the body refit
+        int refits = 2; // rejection rounds, i.e. outliers dropped per body at most
+        int minMarkers = 3;
+    };
+
+    struct SolvedBodyStats {
+        bool valid = false;
+        double residual = 0; // m, weighted RMS over the markers used
+        int markers = 0; // used in the final fit
+        int rejected = 0; // present but dropped as outliers
+    };
+
+    // Rigid body fits of all client-side bodies in one batch. Matched markers are laid out flat (body
+    // after body), per body sums are segment reductions, and the fit itself is the quaternion
+    // characteristic polynomial method (Horn's 4x4 matrix, largest eigenvalue by Newton iterations,
+    // eigenvector from the adjugate), evaluated for all bodies at once in structure-of-arrays form.
+    class MarkerSolver {
+    public:
+        using Array = Eigen::Array<double, Eigen::Dynamic, 1>;
+        using Mask = Eigen::Array<bool, Eigen::Dynamic, 1>;
+        using Poses = Eigen::Array<double, Eigen::Dynamic, 7>;
+
+        size_t size() const { return _begin.size(); }
+
+        void setParams(const SolverParams& params) { _params = params; }
+
+        // Returns the body index; markers already used by another body are ignored. -1 (nothing added)
+        // when fewer than minMarkers unique markers are left.
+        int add(const MarkerTemplate& body)
+        {
+            size_t markers = std::min(body.markerIds.size(), body.positions.size());
+            std::unordered_map<int32_t, int> unique;
+            for (size_t i = 0; i < markers; i++)
+                if (!_slotOfMarker.count(body.markerIds[i]))
+                    unique.emplace(body.markerIds[i], 0);
+            if (static_cast<int>(unique.size()) < std::max(_params.minMarkers, 1)) {
+                OPTITRACK_LOG_WARN("Solved body %s has %zu unique markers, %d needed", body.name.c_str(), unique.size(), std::max(_params.minMarkers, 1));
+                return -1;
+            }
+
+            int index = static_cast<int>(_begin.size());
+            int begin = static_cast<int>(_slots.size());
+            _begin.push_back(begin);
+
+            for (size_t i = 0; i < markers; i++) {
+                if (!_slotOfMarker.emplace(body.markerIds[i], static_cast<int>(_slots.size())).second)
+                    continue;
+                _slots.push_back(index);
+                _template.push_back(body.positions[i]);
+                _weight.push_back(i < body.weights.size() ? body.weights[i] : 1.0);
+            }
+            _count.push_back(static_cast<int>(_slots.size()) - begin);
+
+            // Flat and per body arrays
+            Eigen::Index slots = _slots.size(), bodies = _begin.size();
+            _a.resize(slots, 3);
+            _b.setZero(slots, 3);
+            for (Eigen::Index s = 0; s < slots; s++)
+                _a.row(s) = _template[s].transpose();
+            _slotBody = Eigen::Map<const Eigen::Array<int, Eigen::Dynamic, 1>>(_slots.data(), slots).cast<Eigen::Index>();
+            _templateWeight = Eigen::Map<const Array>(_weight.data(), slots);
+            _present.setConstant(slots, false);
+            _residual.setZero(slots);
+
+            _poses.conservativeResize(bodies, 7);
+            _poses.row(bodies - 1) << 0, 0, 0, 0, 0, 0, 1;
+            _stats.resize(bodies);
+            return index;
+        }
+
+        // Fit every body to the labeled markers of a frame
+        const Poses& solve(const std::vector<sMarker>& markers)
+        {
+            Eigen::Index slots = _slots.size(), bodies = _begin.size();
+            if (!bodies)
+                return _poses;
+
+            // Scatter the markers into their template slots; occluded markers (params bit 0) are absent
+            _present.setConstant(slots, false);
+            for (const sMarker& marker : markers) {
+                auto slot = _slotOfMarker.find(marker.ID);
+                if (slot == _slotOfMarker.end() || (marker.params & 0x01))
+                    continue;
+                _b.row(slot->second) << marker.x, marker.y, marker.z;
+                _present(slot->second) = true;
+            }
+
+            _used = _present;
+            for (int round = 0;; round++) {
+                fit();
+
+                // Residuals of every present marker against its body's fit
+                _fitted.resize(slots, 3);
+                for (int r = 0; r < 3; r++)
+                    _fitted.col(r) = _R.col(3 * r)(_slotBody) * _a.col(0) + _R.col(3 * r + 1)(_slotBody) * _a.col(1) + _R.col(3 * r + 2)(_slotBody) * _a.col(2) + _t.col(r)(_slotBody);
+                _residual = (_fitted - _b).square().rowwise().sum().sqrt();
+
+                if (round == _params.refits)
+                    break;
+
+                // One outlier drags the whole fit, so only each body's worst marker goes per round
+                bool rejected = false;
+                for (Eigen::Index i = 0; i < bodies; i++) {
+                    if (!_count[i])
+                        continue;
+
+                    Eigen::Index worst;
+                    double residual = (_used.segment(_begin[i], _count[i]).cast<double>() * _residual.segment(_begin[i], _count[i])).maxCoeff(&worst);
+                    if (residual > _params.rejectResidual && _used.segment(_begin[i], _count[i]).count() > _params.minMarkers) {
+                        _used(_begin[i] + worst) = false;
+                        rejected = true;
+                    }
+                }
+                if (!rejected)
+                    break;
+            }
+
+            // Results; bodies that cannot be fit keep their last pose
+            for (Eigen::Index i = 0; i < bodies; i++) {
+                SolvedBodyStats& stats = _stats[i];
+                auto used = _used.segment(_begin[i], _count[i]);
+                stats.markers = static_cast<int>(used.count());
+                stats.rejected = static_cast<int>(_present.segment(_begin[i], _count[i]).count()) - stats.markers;
+                stats.valid = _solved(i) && stats.markers >= _params.minMarkers;
+
+                Array w = used.cast<double>() * _templateWeight.segment(_begin[i], _count[i]);
+                double total = w.sum();
+                stats.residual = total > 0 ? std::sqrt((w * _residual.segment(_begin[i], _count[i]).square()).sum() / total) : 0;
+
+                if (stats.valid) {
+                    // Same hemisphere as the previous orientation, so filters see no sign flips
+                    Eigen::Array<double, 1, 4> q = _q.row(i);
+                    if ((q * _poses.block<1, 4>(i, 3)).sum() < 0)
+                        q = -q;
+                    _poses.row(i) << _t(i, 0), _t(i, 1), _t(i, 2), q;
+                }
+            }
+
+            return _poses;
+        }
+
+        // x y z qx qy qz qw of every body after the last solve
+        const Poses& poses() const { return _poses; }
+
+        const SolvedBodyStats& stats(int body) const { return _stats[body]; }
+
+    protected:
+        SolverParams _params;
+
+        // Per slot (template marker), bodies' slots are contiguous
+        std::vector<int> _slots;
+        std::vector<Eigen::Vector3d> _template;
+        std::vector<double> _weight;
+        std::unordered_map<int32_t, int> _slotOfMarker;
+        Eigen::Array<Eigen::Index, Eigen::Dynamic, 1> _slotBody;
+        Eigen::Array<double, Eigen::Dynamic, 3> _a, _b, _fitted;
+        Array _templateWeight, _residual;
+        Mask _present, _used;
+
+        // Per body
+        std::vector<int> _begin, _count;
+        Eigen::Array<double, Eigen::Dynamic, 9> _R; // row major rotation
+        Eigen::Array<double, Eigen::Dynamic, 3> _t;
+        Eigen::Array<double, Eigen::Dynamic, 4> _q; // x y z w
+        Mask _solved;
+        Poses _poses;
+        std::vector<SolvedBodyStats> _stats;
+
+        // Weighted fit of the used markers of every body into _R, _t, _q and _solved
+        void fit()
+        {
+            Eigen::Index slots = _slots.size(), n = _begin.size();
+            Array w = _used.cast<double>() * _templateWeight;
+
+            // Weighted centroids
+            Array total(n);
+            Eigen::Array<double, Eigen::Dynamic, 3> ca(n, 3), cb(n, 3);
+            for (Eigen::Index i = 0; i < n; i++) {
+                auto ws = w.segment(_begin[i], _count[i]);
+                total(i) = std::max(ws.sum(), 1e-12);
+                for (int c = 0; c < 3; c++) {
+                    ca(i, c) = (ws * _a.col(c).segment(_begin[i], _count[i])).sum() / total(i);
+                    cb(i, c) = (ws * _b.col(c).segment(_begin[i], _count[i])).sum() / total(i);
+                }
+            }
+
+            // Centered coordinates and the products of the cross-covariance, per slot
+            Eigen::Array<double, Eigen::Dynamic, 3> da(slots, 3), db(slots, 3);
+            for (int c = 0; c < 3; c++) {
+                da.col(c) = _a.col(c) - ca.col(c)(_slotBody);
+                db.col(c) = _b.col(c) - cb.col(c)(_slotBody);
+            }
+            Eigen::Array<double, Eigen::Dynamic, 11> products(slots, 11);
+            for (int r = 0; r < 3; r++)
+                for (int c = 0; c < 3; c++)
+                    products.col(3 * r + c) = w * da.col(r) * db.col(c);
+            products.col(9) = w * da.square().rowwise().sum();
+            products.col(10) = w * db.square().rowwise().sum();
+
+            Eigen::Array<double, Eigen::Dynamic, 11> sums(n, 11);
+            for (Eigen::Index i = 0; i < n; i++)
+                sums.row(i) = products.middleRows(_begin[i], _count[i]).colwise().sum();
+
+            // Horn's symmetric matrix of S = sum w da db^T, its largest eigenvector is the rotation da -> db
+            Array Sxx = sums.col(0), Sxy = sums.col(1), Sxz = sums.col(2);
+            Array Syx = sums.col(3), Syy = sums.col(4), Syz = sums.col(5);
+            Array Szx = sums.col(6), Szy = sums.col(7), Szz = sums.col(8);
+
+            Array N00 = Sxx + Syy + Szz, N11 = Sxx - Syy - Szz, N22 = -Sxx + Syy - Szz, N33 = -Sxx - Syy + Szz;
+            Array N01 = Syz - Szy, N02 = Szx - Sxz, N03 = Sxy - Syx;
+            Array N12 = Sxy + Syx, N13 = Szx + Sxz, N23 = Syz + Szy;
+
+            // Characteristic polynomial x^4 + c2 x^2 + c1 x + c0 from the power sums tr(N^k)
+            Array P00 = N00 * N00 + N01 * N01 + N02 * N02 + N03 * N03;
+            Array P11 = N01 * N01 + N11 * N11 + N12 * N12 + N13 * N13;
+            Array P22 = N02 * N02 + N12 * N12 + N22 * N22 + N23 * N23;
+            Array P33 = N03 * N03 + N13 * N13 + N23 * N23 + N33 * N33;
+            Array P01 = N00 * N01 + N01 * N11 + N02 * N12 + N03 * N13;
+            Array P02 = N00 * N02 + N01 * N12 + N02 * N22 + N03 * N23;
+            Array P03 = N00 * N03 + N01 * N13 + N02 * N23 + N03 * N33;
+            Array P12 = N01 * N02 + N11 * N12 + N12 * N22 + N13 * N23;
+            Array P13 = N01 * N03 + N11 * N13 + N12 * N23 + N13 * N33;
+            Array P23 = N02 * N03 + N12 * N13 + N22 * N23 + N23 * N33;
+
+            Array p2 = P00 + P11 + P22 + P33;
+            Array p3 = P00 * N00 + P11 * N11 + P22 * N22 + P33 * N33 + 2 * (P01 * N01 + P02 * N02 + P03 * N03 + P12 * N12 + P13 * N13 + P23 * N23);
+            Array p4 = P00.square() + P11.square() + P22.square() + P33.square() + 2 * (P01.square() + P02.square() + P03.square() + P12.square() + P13.square() + P23.square());
+            Array c2 = -p2 / 2, c1 = -p3 / 3, c0 = (p2.square() / 2 - p4) / 4;
+
+            // Newton from the upper bound (Ga + Gb) / 2 converges to the largest root from above
+            Array lambda = (sums.col(9) + sums.col(10)) / 2;
+            for (int k = 0; k < 12; k++) {
+                Array value = ((lambda.square() + c2) * lambda + c1) * lambda + c0;
+                Array slope = (4 * lambda.square() + 2 * c2) * lambda + c1;
+                lambda -= (slope.abs() > 1e-300).select(value / slope, 0.0);
+            }
+
+            // Eigenvector: generalized cross product of three rows of N - lambda I, from two row
+            // triples to stay away from the degenerate one
+            Array A00 = N00 - lambda, A11 = N11 - lambda, A22 = N22 - lambda, A33 = N33 - lambda;
+            Array u0, u1, u2, u3, v0, v1, v2, v3;
+            cross(N01, A11, N12, N13, N02, N12, A22, N23, N03, N13, N23, A33, u0, u1, u2, u3);
+            cross(A00, N01, N02, N03, N01, A11, N12, N13, N02, N12, A22, N23, v0, v1, v2, v3);
+            Array un = u0.square() + u1.square() + u2.square() + u3.square();
+            Array vn = v0.square() + v1.square() + v2.square() + v3.square();
+            Mask first = un >= vn;
+            Array norm = first.select(un, vn).sqrt();
+
+            // Below three markers (or collinear ones) the rotation is not determined
+            _solved = norm > 1e-30;
+            for (Eigen::Index i = 0; i < n; i++)
+                _solved(i) = _solved(i) && _used.segment(_begin[i], _count[i]).count() >= 3;
+            Array safe = (norm > 1e-30).select(norm, 1.0);
+
+            Array qw = first.select(u0, v0) / safe, qx = first.select(u1, v1) / safe;
+            Array qy = first.select(u2, v2) / safe, qz = first.select(u3, v3) / safe;
+            _q.resize(n, 4);
+            _q << qx, qy, qz, qw;
+
+            _R.resize(n, 9);
+            _R.col(0) = 1 - 2 * (qy * qy + qz * qz);
+            _R.col(1) = 2 * (qx * qy - qz * qw);
+            _R.col(2) = 2 * (qx * qz + qy * qw);
+            _R.col(3) = 2 * (qx * qy + qz * qw);
+            _R.col(4) = 1 - 2 * (qx * qx + qz * qz);
+            _R.col(5) = 2 * (qy * qz - qx * qw);
+            _R.col(6) = 2 * (qx * qz - qy * qw);
+            _R.col(7) = 2 * (qy * qz + qx * qw);
+            _R.col(8) = 1 - 2 * (qx * qx + qy * qy);
+
+            // t = cb - R ca
+            _t.resize(n, 3);
+            for (int r = 0; r < 3; r++)
+                _t.col(r) = cb.col(r) - (_R.col(3 * r) * ca.col(0) + _R.col(3 * r + 1) * ca.col(1) + _R.col(3 * r + 2) * ca.col(2));
+        }
+
+        static Array det3(const Array& a0, const Array& a1, const Array& a2, const Array& b0, const Array& b1, const Array& b2, const Array& c0, const Array& c1, const Array& c2)
+        {
+            return a0 * (b1 * c2 - b2 * c1) - a1 * (b0 * c2 - b2 * c0) + a2 * (b0 * c1 - b1 * c0);
+        }
+
+        // Vector orthogonal to the 4-vectors a, b and c
+        static void cross(const Array& a0, const Array& a1, const Array& a2, const Array& a3, const Array& b0, const Array& b1, const Array& b2, const Array& b3,
+            const Array& c0, const Array& c1, const Array& c2, const Array& c3, Array& x0, Array& x1, Array& x2, Array& x3)
+        {
+            x0 = det3(a1, a2, a3, b1, b2, b3, c1, c2, c3);
+            x1 = -det3(a0, a2, a3, b0, b2, b3, c0, c2, c3);
+            x2 = det3(a0, a1, a3, b0, b1, b3, c0, c1, c3);
+            x3 = -det3(a0, a1, a2, b0, b1, b2, c0, c1, c2);
+        }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_MARKERSOLVER_HPP
@@ -0,0 +1,299 @@
+#ifndef OPTITRACKLIB_METRICS_HPP
+#define OPTITRACKLIB_METRICS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <inttypes.h>
+
+namespace optitrack_lib {
+    namespace metrics {
+        // Writers are spread over shards so that the receive thread never shares a cache line with
+        // another writer; readers sum the shards
+        constexpr size_t kShards = 16;
+
+        inline size_t shard()
+        {
+            static std::atomic<size_t> next{0};
+            thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+            return index;
+        }
+
+        // Label value escaping of the Prometheus text format
+        inline std::string escape(const std::string& value)
+        {
+            std::string escaped;
+            escaped.reserve(value.size());
+            for (char c : value) {
+                if (c == '\\' || c == '"')
+                    escaped += '\\';
+                if (c == '\n')
+                    escaped += "\\n";
+                else
+                    escaped += c;
+            }
+            return escaped;
+        }
+
+        // Seconds buckets from 50 us to 100 ms, for latencies and jitter
+        inline std::vector<double> latencyBuckets() { return {5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2, 1e-1}; }
+
+        // Quantile q in [0, 1] of per bucket counts (as Histogram::counts(), possibly the difference of
+        // two snapshots), interpolated linearly within the bucket like Prometheus' histogram_quantile
+        inline double quantile(const std::vector<double>& bounds, const std::vector<uint64_t>& counts, double q)
+        {
+            uint64_t total = 0;
+            for (uint64_t count : counts)
+                total += count;
+            if (!total)
+                return 0;
+
+            double rank = q * total, cumulative = 0;
+            for (size_t b = 0; b < counts.size(); b++) {
+                if (cumulative + counts[b] >= rank && counts[b]) {
+                    // Observations above the last bound are reported as the last bound
+                    if (b == bounds.size())
+                        return bounds.empty() ? 0 : bounds.back();
+                    double lower = b ? bounds[b - 1] : 0;
+                    return lower + (bounds[b] - lower) * (rank - cumulative) / counts[b];
+                }
+                cumulative += counts[b];
+            }
+            return bounds.empty() ? 0 : bounds.back();
+        }
+    } // namespace metrics
+
+    // Monotonic count; add() is a relaxed increment of the calling thread's shard
+    class Counter {
+    public:
+        void add(uint64_t n = 1) { _shards[metrics::shard()].value.fetch_add(n, std::memory_order_relaxed); }
+
+        uint64_t value() const
+        {
+            uint64_t total = 0;
+            for (const Shard& shard : _shards)
+                total += shard.value.load(std::memory_order_relaxed);
+            return total;
+        }
+
+    protected:
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> value{0};
+        };
+        std::array<Shard, metrics::kShards> _shards;
+    };
+
+    // Last written value
+    class Gauge {
+    public:
+        void set(double value) { _value.store(value, std::memory_order_relaxed); }
+
+        double value() const { return _value.load(std::memory_order_relaxed); }
+
+    protected:
+        std::atomic<double> _value{0};
+    };
+
+    // Cumulative histogram with fixed upper bounds (plus +Inf), sharded like Counter
+    class Histogram {
+    public:
+        Histogram(std::vector<double> bounds) : _bounds(std::move(bounds))
+        {
+            std::sort(_bounds.begin(), _bounds.end());
+            // Each shard's buckets start on their own cache line
+            _stride = (_bounds.size() + 1 + 7) / 8 * 8;
+            _counts.reset(new std::atomic<uint64_t>[metrics::kShards * _stride]());
+        }
+
+        void observe(double value)
+        {
+            size_t shard = metrics::shard();
+            size_t bucket = std::lower_bound(_bounds.begin(), _bounds.end(), value) - _bounds.begin();
+            _counts[shard * _stride + bucket].fetch_add(1, std::memory_order_relaxed);
+
+            std::atomic<double>& sum = _sums[shard].value;
+            double current = sum.load(std::memory_order_relaxed);
+            while (!sum.compare_exchange_weak(current, current + value, std::memory_order_relaxed))
+                ;
+        }
+
+        const std::vector<double>& bounds() const { return _bounds; }
+
+        // Per bucket counts (not cumulative), the last one is +Inf
+        std::vector<uint64_t> counts() const
+        {
+            std::vector<uint64_t> counts(_bounds.size() + 1, 0);
+            for (size_t shard = 0; shard < metrics::kShards; shard++)
+                for (size_t bucket = 0; bucket < counts.size(); bucket++)
+                    counts[bucket] += _counts[shard * _stride + bucket].load(std::memory_order_relaxed);
+            return counts;
+        }
+
+        double sum() const
+        {
+            double total = 0;
+            for (const Sum& sum : _sums)
+                total += sum.value.load(std::memory_order_relaxed);
+            return total;
+        }
+
+    protected:
+        struct alignas(64) Sum {
+            std::atomic<double> value{0};
+        };
+
+        std::vector<double> _bounds;
+        size_t _stride;
+        std::unique_ptr<std::atomic<uint64_t>[]> _counts;
+        std::array<Sum, metrics::kShards> _sums;
+    };
+
+    // Named metrics rendered in the Prometheus text exposition format. Metrics are registered once at
+    // setup and written through the returned references, so the hot path never touches the registry.
+    // Collectors produce samples at scrape time from state owned elsewhere (e.g. per-body tables).
+    class MetricsRegistry {
+    public:
+        using Collector = std::function<void(std::string&)>;
+
+        // labels: preformatted label list, e.g. "body=\"Body_0\""
+        Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "")
+        {
+            return add<Counter>(name, help, "counter", labels, std::make_unique<Counter>());
+        }
+
+        Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "")
+        {
+            return add<Gauge>(name, help, "gauge", labels, std::make_unique<Gauge>());
+        }
+
+        Histogram& histogram(const std::string& name, const std::string& help, const std::vector<double>& bounds = metrics::latencyBuckets(), const std::string& labels = "")
+        {
+            return add<Histogram>(name, help, "histogram", labels, std::make_unique<Histogram>(bounds));
+        }
+
+        // Registered histogram, nullptr if there is none with that name and labels
+        const Histogram* findHistogram(const std::string& name, const std::string& labels = "")
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (const Entry& entry : _entries)
+                if (entry.histogram && entry.name == name && entry.labels == labels)
+                    return entry.histogram.get();
+            return nullptr;
+        }
+
+        void collect(Collector collector)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _collectors.push_back(std::move(collector));
+        }
+
+        std::string render()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::string out;
+
+            // Families in registration order, HELP and TYPE once per family
+            for (size_t i = 0; i < _entries.size(); i++) {
+                bool first = std::none_of(_entries.begin(), _entries.begin() + i, [&](const Entry& e) { return e.name == _entries[i].name; });
+                if (!first)
+                    continue;
+
+                family(out, _entries[i].name, _entries[i].help, _entries[i].type);
+                for (const Entry& entry : _entries)
+                    if (entry.name == _entries[i].name)
+                        render(out, entry);
+            }
+
+            for (const Collector& collector : _collectors)
+                collector(out);
+
+            return out;
+        }
+
+        // Helpers for collectors
+        static void family(std::string& out, const std::string& name, const std::string& help, const std::string& type)
+        {
+            out += "# HELP " + name + " " + help + "\n# TYPE " + name + " " + type + "\n";
+        }
+
+        static void sample(std::string& out, const std::string& name, const std::string& labels, double value)
+        {
+            char buffer[64];
+            std::snprintf(buffer, sizeof(buffer), " %.9g\n", value);
+            out += name + (labels.empty() ? "" : "{" + labels + "}") + buffer;
+        }
+
+        static void sample(std::string& out, const std::string& name, const std::string& labels, uint64_t value)
+        {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), " %" PRIu64 "\n", value);
+            out += name + (labels.empty() ? "" : "{" + labels + "}") + buffer;
+        }
+
+    protected:
+        struct Entry {
+            std::string name, help, type, labels;
+            std::unique_ptr<Counter> counter;
+            std::unique_ptr<Gauge> gauge;
+            std::unique_ptr<Histogram> histogram;
+        };
+
+        std::mutex _mutex;
+        std::vector<Entry> _entries;
+        std::vector<Collector> _collectors;
+
+        template <typename Metric>
+        Metric& add(const std::string& name, const std::string& help, const char* type, const std::string& labels, std::unique_ptr<Metric> metric)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            Metric& reference = *metric;
+
+            Entry entry{name, help, type, labels, nullptr, nullptr, nullptr};
+            if constexpr (std::is_same_v<Metric, Counter>)
+                entry.counter = std::move(metric);
+            else if constexpr (std::is_same_v<Metric, Gauge>)
+                entry.gauge = std::move(metric);
+            else
+                entry.histogram = std::move(metric);
+
+            _entries.push_back(std::move(entry));
+            return reference;
+        }
+
+        static void render(std::string& out, const Entry& entry)
+        {
+            if (entry.counter)
+                sample(out, entry.name, entry.labels, entry.counter->value());
+            else if (entry.gauge)
+                sample(out, entry.name, entry.labels, entry.gauge->value());
+            else {
+                const Histogram& histogram = *entry.histogram;
+                std::vector<uint64_t> counts = histogram.counts();
+                std::string prefix = entry.labels.empty() ? "" : entry.labels + ",";
+
+                uint64_t cumulative = 0;
+                char bound[32];
+                for (size_t b = 0; b < counts.size(); b++) {
+                    cumulative += counts[b];
+                    if (b < histogram.bounds().size())
+                        std::snprintf(bound, sizeof(bound), "%g", histogram.bounds()[b]);
+                    else
+                        std::snprintf(bound, sizeof(bound), "+Inf");
+                    sample(out, entry.name + "_bucket", prefix + "le=\"" + bound + "\"", cumulative);
+                }
+                sample(out, entry.name + "_sum", entry.labels, histogram.sum());
+                sample(out, entry.name + "_count", entry.labels, cumulative);
+            }
+        }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_METRICS_HPP
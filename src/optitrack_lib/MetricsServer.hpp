@@ -0,0 +1,152 @@
+#ifndef OPTITRACKLIB_METRICSSERVER_HPP
+#define OPTITRACKLIB_METRICSSERVER_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "optitrack_lib/Log.hpp"
+#include "optitrack_lib/Metrics.hpp"
+
+namespace optitrack_lib {
+    struct MetricsEndpoint {
+        std::string address = "127.0.0.1"; // "0.0.0.0" to let a remote Prometheus scrape
+        uint16_t port = 9464; // 0 disables the TCP endpoint
+        std::string socketPath; // Unix socket, e.g. for curl --unix-socket; empty disables it
+    };
+
+    // Minimal HTTP/1.0 endpoint serving the registry on any path, from its own thread. A scrape only
+    // reads the metrics' atomics and runs the collectors, it never waits on the receive thread.
+    class MetricsServer {
+    public:
+        MetricsServer(MetricsRegistry& registry, const MetricsEndpoint& endpoint = MetricsEndpoint()) : _registry(registry), _endpoint(endpoint)
+        {
+            if (endpoint.port)
+                listenTcp();
+            if (!endpoint.socketPath.empty())
+                listenUnix();
+
+            if (!_sockets.empty())
+                _thread = std::thread([this]() { run(); });
+        }
+
+        ~MetricsServer()
+        {
+            _running = false;
+            if (_thread.joinable())
+                _thread.join();
+
+            for (int fd : _sockets)
+                close(fd);
+            if (!_endpoint.socketPath.empty())
+                unlink(_endpoint.socketPath.c_str());
+        }
+
+        bool listening() const { return !_sockets.empty(); }
+
+    protected:
+        MetricsRegistry& _registry;
+        MetricsEndpoint _endpoint;
+        std::vector<int> _sockets;
+        std::thread _thread;
+        std::atomic<bool> _running{true};
+
+        void listenTcp()
+        {
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            int reuse = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(_endpoint.port);
+            if (fd < 0 || inet_pton(AF_INET, _endpoint.address.c_str(), &address.sin_addr) != 1
+                || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, 8) != 0) {
+                OPTITRACK_LOG_ERROR("Metrics endpoint %s:%u unavailable: %s", _endpoint.address.c_str(), _endpoint.port, strerror(errno));
+                if (fd >= 0)
+                    close(fd);
+                return;
+            }
+
+            _sockets.push_back(fd);
+        }
+
+        void listenUnix()
+        {
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+            sockaddr_un address = {};
+            address.sun_family = AF_UNIX;
+            std::strncpy(address.sun_path, _endpoint.socketPath.c_str(), sizeof(address.sun_path) - 1);
+            unlink(address.sun_path);
+
+            if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, 8) != 0) {
+                OPTITRACK_LOG_ERROR("Metrics socket %s unavailable: %s", _endpoint.socketPath.c_str(), strerror(errno));
+                if (fd >= 0)
+                    close(fd);
+                return;
+            }
+
+            _sockets.push_back(fd);
+        }
+
+        void run()
+        {
+            std::vector<pollfd> fds;
+            for (int fd : _sockets)
+                fds.push_back({fd, POLLIN, 0});
+
+            while (_running) {
+                // Wake up regularly to notice shutdown
+                if (poll(fds.data(), fds.size(), 200) <= 0)
+                    continue;
+
+                for (const pollfd& fd : fds)
+                    if (fd.revents & POLLIN) {
+                        int client = accept(fd.fd, nullptr, nullptr);
+                        if (client >= 0) {
+                            serve(client);
+                            close(client);
+                        }
+                    }
+            }
+        }
+
+        void serve(int client)
+        {
+            // The request itself does not matter, read its head (bounded in time) and answer
+            timeval timeout = {1, 0};
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+            char request[1024];
+            if (recv(client, request, sizeof(request), 0) <= 0)
+                return;
+
+            std::string body = _registry.render();
+            std::string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+
+            size_t sent = 0;
+            while (sent < response.size()) {
+                ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                if (n <= 0)
+                    return;
+                sent += n;
+            }
+        }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_METRICSSERVER_HPP
@@ -0,0 +1,149 @@
+#ifndef OPTITRACKLIB_MOCAPFRAME_HPP
+#define OPTITRACKLIB_MOCAPFRAME_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <NatNet/NatNetTypes.h>
+
+#include "optitrack_lib/Policies.hpp"
+
+namespace optitrack_lib {
+    struct MarkerSetSample {
+        std::string name;
+        std::vector<std::array<float, 3>> markers;
+    };
+
+    struct SkeletonSample {
+        int32_t id;
+        std::vector<sRigidBodyData> bones;
+    };
+
+    // Force plate or peripheral device; one vector of subframe values per channel
+    struct AnalogSample {
+        int32_t id;
+        int16_t params;
+        std::vector<std::vector<float>> channels;
+    };
+
+    // Compact copy of the populated part of a NatNet frame. sFrameOfMocapData reserves room for the
+    // maximum of every category (hundreds of kB); this keeps only what was received and ingested, and
+    // reuses its buffers when assigned again.
+    struct MocapFrame {
+        int32_t iFrame = 0;
+        int16_t params = 0;
+        uint64_t cameraMidExposureTimestamp = 0;
+        uint64_t transmitTimestamp = 0;
+        uint32_t precisionTimestampSecs = 0;
+        uint32_t precisionTimestampFractionalSecs = 0;
+
+        std::vector<sRigidBodyData> rigidBodies;
+        std::vector<MarkerSetSample> markerSets;
+        std::vector<sMarker> labeledMarkers;
+        std::vector<std::array<float, 3>> unlabeledMarkers;
+        std::vector<SkeletonSample> skeletons;
+        std::vector<AnalogSample> forcePlates, devices;
+
+        double transitLatencyMillisec = 0;
+        double clientLatencyMillisec = 0;
+        std::chrono::steady_clock::time_point receivedAt;
+        std::chrono::steady_clock::time_point exposureTime; // camera mid-exposure in local steady_clock time
+        double exposureErrorBound = 0; // seconds
+
+        // Copy the categories in the compile-time set that are also enabled at runtime (enabled: Category mask)
+        template <uint32_t Categories>
+        void assign(const sFrameOfMocapData& data, uint32_t enabled = AllCategories)
+        {
+            iFrame = data.iFrame;
+            params = data.params;
+            cameraMidExposureTimestamp = data.CameraMidExposureTimestamp;
+            transmitTimestamp = data.TransmitTimestamp;
+            precisionTimestampSecs = data.PrecisionTimestampSecs;
+            precisionTimestampFractionalSecs = data.PrecisionTimestampFractionalSecs;
+
+            if constexpr ((Categories & RigidBodies) != 0)
+                rigidBodies.assign(data.RigidBodies, data.RigidBodies + ((enabled & RigidBodies) ? data.nRigidBodies : 0));
+
+            if constexpr ((Categories & MarkerSets) != 0) {
+                markerSets.resize((enabled & MarkerSets) ? data.nMarkerSets : 0);
+                for (size_t i = 0; i < markerSets.size(); i++) {
+                    markerSets[i].name = data.MocapData[i].szName;
+                    markerSets[i].markers.resize(data.MocapData[i].nMarkers);
+                    for (size_t j = 0; j < markerSets[i].markers.size(); j++)
+                        markerSets[i].markers[j] = {data.MocapData[i].Markers[j][0], data.MocapData[i].Markers[j][1], data.MocapData[i].Markers[j][2]};
+                }
+            }
+
+            if constexpr ((Categories & LabeledMarkers) != 0)
+                labeledMarkers.assign(data.LabeledMarkers, data.LabeledMarkers + ((enabled & LabeledMarkers) ? data.nLabeledMarkers : 0));
+
+            if constexpr ((Categories & UnlabeledMarkers) != 0) {
+                unlabeledMarkers.resize((enabled & UnlabeledMarkers) && data.OtherMarkers ? data.nOtherMarkers : 0);
+                for (size_t i = 0; i < unlabeledMarkers.size(); i++)
+                    unlabeledMarkers[i] = {data.OtherMarkers[i][0], data.OtherMarkers[i][1], data.OtherMarkers[i][2]};
+            }
+
+            if constexpr ((Categories & Skeletons) != 0) {
+                skeletons.resize((enabled & Skeletons) ? data.nSkeletons : 0);
+                for (size_t i = 0; i < skeletons.size(); i++) {
+                    skeletons[i].id = data.Skeletons[i].skeletonID;
+                    skeletons[i].bones.assign(data.Skeletons[i].RigidBodyData, data.Skeletons[i].RigidBodyData + data.Skeletons[i].nRigidBodies);
+                }
+            }
+
+            if constexpr ((Categories & ForcePlates) != 0) {
+                forcePlates.resize((enabled & ForcePlates) ? data.nForcePlates : 0);
+                for (size_t i = 0; i < forcePlates.size(); i++)
+                    assignAnalog(forcePlates[i], data.ForcePlates[i].ID, data.ForcePlates[i].params, data.ForcePlates[i].nChannels, data.ForcePlates[i].ChannelData);
+            }
+
+            if constexpr ((Categories & Devices) != 0) {
+                devices.resize((enabled & Devices) ? data.nDevices : 0);
+                for (size_t i = 0; i < devices.size(); i++)
+                    assignAnalog(devices[i], data.Devices[i].ID, data.Devices[i].params, data.Devices[i].nChannels, data.Devices[i].ChannelData);
+            }
+        }
+
+        // Allocate (and touch) the flat buffers of the compile-time categories up to the NatNet maxima,
+        // so that they never reallocate in assign(). The nested buffers (markers of each marker set, bones
+        // of each skeleton, names, analog channels) still grow the first time a larger frame comes in and
+        // keep their capacity afterwards.
+        template <uint32_t Categories>
+        void reserve()
+        {
+            if constexpr ((Categories & RigidBodies) != 0)
+                prefault(rigidBodies, MAX_RIGIDBODIES);
+            if constexpr ((Categories & LabeledMarkers) != 0)
+                prefault(labeledMarkers, MAX_LABELED_MARKERS);
+            if constexpr ((Categories & UnlabeledMarkers) != 0)
+                prefault(unlabeledMarkers, MAX_UNLABELED_MARKERS);
+            if constexpr ((Categories & MarkerSets) != 0)
+                markerSets.reserve(MAX_MARKERSETS);
+            if constexpr ((Categories & Skeletons) != 0)
+                skeletons.reserve(MAX_SKELETONS);
+        }
+
+    protected:
+        template <typename T>
+        static void prefault(std::vector<T>& buffer, size_t capacity)
+        {
+            size_t size = buffer.size();
+            buffer.resize(std::max(size, capacity));
+            buffer.resize(size);
+        }
+
+        static void assignAnalog(AnalogSample& sample, int32_t id, int16_t params, int32_t nChannels, const sAnalogChannelData* channels)
+        {
+            sample.id = id;
+            sample.params = params;
+            sample.channels.resize(nChannels);
+            for (int32_t c = 0; c < nChannels; c++)
+                sample.channels[c].assign(channels[c].Values, channels[c].Values + channels[c].nFrames);
+        }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_MOCAPFRAME_HPP
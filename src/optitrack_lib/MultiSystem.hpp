@@ -0,0 +1,218 @@
+#ifndef OPTITRACKLIB_MULTISYSTEM_HPP
+#define OPTITRACKLIB_MULTISYSTEM_HPP
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "optitrack_lib/Optitrack.hpp"
+
+namespace optitrack_lib {
+    struct SourceHealth {
+        bool connected = false;
+        bool stale = false;
+        double measuredRate = 0;
+        double expectedRate = 0;
+        double lastFrameAge = 0; // seconds
+        double skew = 0; // seconds between the source's last frame and the aligned reference time
+        size_t reconnectAttempts = 0;
+        size_t reconnects = 0; // successful
+    };
+
+    // Several independent NatNet connections merged into one handle-indexed pose table.
+    // Every source has its own NatNet client (and receive thread) and an extrinsic transform
+    // from its capture volume into the common world frame. Global body names are "source/body".
+    // The merged table is time-aligned: every source is resampled at referenceTime() from its
+    // accepted history (see Resampler), so bodies of different systems describe the same instant.
+    class MultiSystem {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        int addSource(const std::string& name, const Eigen::Isometry3d& extrinsic = Eigen::Isometry3d::Identity())
+        {
+            _sources.push_back(std::make_unique<Source>());
+            _sources.back()->name = name;
+            _sources.back()->extrinsic = extrinsic;
+            _sources.back()->resampler.setOptions(_alignment);
+            return static_cast<int>(_sources.size()) - 1;
+        }
+
+        // Each source keeps its own server cache, named after the source
+        bool connect(int source, const DiscoveryOptions& options, const WatchdogOptions& watchdog = WatchdogOptions())
+        {
+            DiscoveryOptions sourceOptions = options;
+            if (!sourceOptions.cachePath.empty())
+                sourceOptions.cachePath += "." + _sources[source]->name;
+
+            return finishConnect(source, _sources[source]->client.connect(sourceOptions), watchdog);
+        }
+
+        bool connect(int source, const std::string& server, const std::string& local = "", const WatchdogOptions& watchdog = WatchdogOptions())
+        {
+            return finishConnect(source, _sources[source]->client.connect(server, local), watchdog);
+        }
+
+        Optitrack& source(int source) { return _sources[source]->client; }
+
+        size_t numSources() const { return _sources.size(); }
+
+        // "source/body" addresses one body; a bare "body" resolves to the first source streaming it
+        int handle(const std::string& bodyName)
+        {
+            auto it = _handles.find(bodyName);
+            if (it != _handles.end())
+                return it->second;
+
+            it = _unqualified.find(bodyName);
+            return it != _unqualified.end() ? it->second : -1;
+        }
+
+        const std::string& name(int handle) const { return _names[handle]; }
+
+        int sourceOf(int handle) const { return _sourceOf[handle]; }
+
+        size_t numBodies() const { return _poses.size(); }
+
+        const Eigen::Matrix<double, 7, 1>& rigidBody(int handle) const { return _poses[handle]; }
+
+        // referenceTime() for aligned poses, the exposure of the pose otherwise
+        Clock::time_point timestamp(int handle) const { return _timestamps[handle]; }
+
+        // How the body's pose was aligned to referenceTime()
+        SampleKind kind(int handle) const { return _kinds[handle]; }
+
+        // Interpolation and extrapolation bounds of the alignment (rate, delay and update are unused)
+        void setAlignment(const ResamplerOptions& options)
+        {
+            for (auto& source : _sources)
+                source->resampler.setOptions(options);
+            _alignment = options;
+        }
+
+        // Latest time for which every healthy source has delivered data
+        Clock::time_point referenceTime() const { return _referenceTime; }
+
+        SourceHealth health(int source)
+        {
+            Source& s = *_sources[source];
+            WatchdogStats stats = s.client.watchdogStats();
+
+            SourceHealth health;
+            health.connected = s.connected;
+            health.stale = stats.stale;
+            health.measuredRate = stats.measuredRate;
+            health.expectedRate = stats.expectedRate;
+            health.lastFrameAge = stats.lastFrameAge;
+            health.skew = std::chrono::duration<double>(s.frameTime - _referenceTime).count();
+            health.reconnectAttempts = stats.attempts;
+            health.reconnects = stats.reconnects;
+
+            return health;
+        }
+
+        // Consume every source, then resample each one at the common reference time and merge it into
+        // the global table; linear in the total body count
+        void updateData()
+        {
+            Clock::time_point reference = Clock::time_point::max();
+            for (auto& source : _sources) {
+                Source& s = *source;
+                if (!s.connected)
+                    continue;
+
+                s.client.updateData();
+                s.frameTime = s.client.frameTime();
+                if (!s.client.watchdogStats().stale && s.frameTime != Clock::time_point())
+                    reference = std::min(reference, s.frameTime);
+            }
+
+            if (reference != Clock::time_point::max())
+                _referenceTime = reference;
+
+            for (size_t i = 0; i < _sources.size(); i++) {
+                Source& s = *_sources[i];
+                if (!s.connected)
+                    continue;
+
+                s.client.resample(s.resampler, _referenceTime);
+                s.client.table(s.poses, s.timestamps);
+
+                // Bodies appear in a source table only by growing it, so only new entries need a global handle
+                while (s.toGlobal.size() < s.poses.size()) {
+                    int global = static_cast<int>(_poses.size());
+                    std::string bodyName = s.client.name(static_cast<int>(s.toGlobal.size()));
+
+                    _handles.emplace(s.name + "/" + bodyName, global);
+                    _unqualified.emplace(bodyName, global);
+                    _names.push_back(s.name + "/" + bodyName);
+                    _sourceOf.push_back(static_cast<int>(i));
+                    _poses.push_back((Eigen::Matrix<double, 7, 1>() << 0, 0, 0, 0, 0, 0, 1).finished());
+                    _timestamps.push_back(Clock::time_point());
+                    _kinds.push_back(SampleKind::Missing);
+                    s.toGlobal.push_back(global);
+                }
+
+                Eigen::Quaterniond rotation(s.extrinsic.rotation());
+
+                // The resampler covers the bodies known when it ran, newer ones keep their raw pose
+                size_t resampled = s.resampler.size();
+                for (size_t j = 0; j < s.poses.size(); j++) {
+                    int global = s.toGlobal[j];
+                    SampleKind kind = j < resampled ? s.resampler.kind(static_cast<int>(j)) : SampleKind::Missing;
+                    Eigen::Matrix<double, 7, 1> pose = kind == SampleKind::Missing ? s.poses[j] : s.resampler.pose(static_cast<int>(j));
+                    Eigen::Quaterniond orientation(pose(6), pose(3), pose(4), pose(5));
+
+                    _poses[global].head<3>() = s.extrinsic * pose.head<3>();
+                    _poses[global].tail<4>() = (rotation * orientation).coeffs();
+                    _timestamps[global] = kind == SampleKind::Interpolated || kind == SampleKind::Extrapolated ? _referenceTime : s.timestamps[j];
+                    _kinds[global] = kind;
+                }
+            }
+        }
+
+    protected:
+        struct Source {
+            std::string name;
+            Eigen::Isometry3d extrinsic;
+            Optitrack client;
+            bool connected = false;
+
+            // Scratch copies of the source table, reused every update
+            std::vector<Eigen::Matrix<double, 7, 1>> poses;
+            std::vector<Clock::time_point> timestamps;
+            std::vector<int> toGlobal;
+            Clock::time_point frameTime;
+            Resampler resampler;
+        };
+
+        std::vector<std::unique_ptr<Source>> _sources;
+
+        std::unordered_map<std::string, int> _handles, _unqualified;
+        std::vector<std::string> _names;
+        std::vector<int> _sourceOf;
+        std::vector<Eigen::Matrix<double, 7, 1>> _poses;
+        std::vector<Clock::time_point> _timestamps;
+        std::vector<SampleKind> _kinds;
+        Clock::time_point _referenceTime;
+        ResamplerOptions _alignment;
+
+        bool finishConnect(int source, bool connected, const WatchdogOptions& watchdog)
+        {
+            Source& s = *_sources[source];
+            s.connected = connected;
+
+            if (connected) {
+                s.client.updateDataDescriptions();
+                s.client.enableWatchdog(watchdog);
+            }
+
+            return connected;
+        }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_MULTISYSTEM_HPP
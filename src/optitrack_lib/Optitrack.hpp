@@ -1,7 +1,8 @@
 #ifndef OPTITRACKLIB_OPTITRACK_HPP
 #define OPTITRACKLIB_OPTITRACK_HPP
 
-#include <map>
+#include <array>
+#include <cmath>
 #include <string>
 #include <vector>
 #include <deque>
@@ -9,10 +10,12 @@
 #include <mutex>
 #include <memory>
 #include <chrono>
+#include <future>
+#include <condition_variable>
+#include <atomic>
+#include <limits>
 
 #include <inttypes.h>
-#include <termios.h>
-#include <unistd.h>
 
 #include <NatNet/NatNetCAPI.h>
 #include <NatNet/NatNetClient.h>
@@ -21,224 +24,1019 @@
 #include <Eigen/Core>
 #include <unordered_map>
 
+#include "optitrack_lib/BroadcastRing.hpp"
+#include "optitrack_lib/ClockModel.hpp"
+#include "optitrack_lib/CommandChannel.hpp"
+#include "optitrack_lib/Coroutines.hpp"
+#include "optitrack_lib/DescriptionCache.hpp"
+#include "optitrack_lib/Discovery.hpp"
+#include "optitrack_lib/FilterBank.hpp"
+#include "optitrack_lib/Gating.hpp"
+#include "optitrack_lib/JitterBuffer.hpp"
+#include "optitrack_lib/Log.hpp"
+#include "optitrack_lib/MarkerSolver.hpp"
+#include "optitrack_lib/Metrics.hpp"
+#include "optitrack_lib/MocapFrame.hpp"
+#include "optitrack_lib/Policies.hpp"
+#include "optitrack_lib/PoseChanges.hpp"
+#include "optitrack_lib/PoseHistory.hpp"
+#include "optitrack_lib/RealTime.hpp"
+#include "optitrack_lib/RelativePoses.hpp"
+#include "optitrack_lib/Resampler.hpp"
+#include "optitrack_lib/Subscription.hpp"
+#include "optitrack_lib/Tracing.hpp"
+#include "optitrack_lib/Watchdog.hpp"
+#include "optitrack_lib/Zones.hpp"
+
 using namespace std::chrono_literals;
 
 namespace optitrack_lib {
-    std::vector<sNatNetDiscoveredServer> discoveredServers;
+    // Server metadata, cached after the first response
+    struct ServerInfo {
+        sServerDescription description;
+        float frameRate = 0;
+        int analogSamplesPerMocapFrame = 0;
+    };
 
-    void NATNET_CALLCONV ServerDiscoveredCallback(const sNatNetDiscoveredServer* pDiscoveredServer, void* pUserContext)
-    {
-        char serverHotkey = '.';
-        if (discoveredServers.size() < 9) {
-            serverHotkey = static_cast<char>('1' + discoveredServers.size());
+    namespace detail {
+        // MessageHandler receives NatNet error/debug messages, possibly on the network thread
+        inline void NATNET_CALLCONV MessageHandler(Verbosity msgType, const char* msg)
+        {
+            switch (msgType) {
+            case Verbosity_Debug:
+                OPTITRACK_LOG_DEBUG("[NatNetLib] %s", msg);
+                break;
+            case Verbosity_Info:
+                OPTITRACK_LOG_INFO("[NatNetLib] %s", msg);
+                break;
+            case Verbosity_Warning:
+                OPTITRACK_LOG_WARN("[NatNetLib] %s", msg);
+                break;
+            default:
+                OPTITRACK_LOG_ERROR("[NatNetLib] %s", msg);
+                break;
+            }
         }
 
-        printf("[%c] %s %d.%d at %s ",
-            serverHotkey,
-            pDiscoveredServer->serverDescription.szHostApp,
-            pDiscoveredServer->serverDescription.HostAppVersion[0],
-            pDiscoveredServer->serverDescription.HostAppVersion[1],
-            pDiscoveredServer->serverAddress);
+        // Health metrics of one client, registered in its registry at construction
+        struct ClientMetrics {
+            ClientMetrics(MetricsRegistry& registry)
+                : framesReceived(registry.counter("optitrack_frames_received_total", "Frames delivered by NatNet")),
+                  framesDropped(registry.counter("optitrack_frames_dropped_total", "Frames dropped because a lossless reader was a whole ring behind")),
+                  framesOverwritten(registry.counter("optitrack_frames_overwritten_total", "Queued frames overwritten before updateData() consumed them")),
+                  framesDuplicate(registry.counter("optitrack_frames_duplicate_total", "Frames whose number is not newer than the previous one")),
+                  framesSkipped(registry.counter("optitrack_frames_skipped_total", "Gaps in the frame numbers received")),
+                  descriptionRefreshes(registry.counter("optitrack_description_refreshes_total", "Data description updates")),
+                  reconnects(registry.counter("optitrack_reconnects_total", "Successful reconnections")),
+                  poseChanges(registry.counter("optitrack_pose_changes_total", "Pose changes beyond the deadbands of a listener")),
+                  poseChangesCoalesced(registry.counter("optitrack_pose_changes_coalesced_total", "Pose changes replaced by a newer one before their callback ran")),
+                  connected(registry.gauge("optitrack_connected", "1 while connected to a server")),
+                  queueDepth(registry.gauge("optitrack_queue_depth", "Frames waiting for updateData()")),
+                  frameJitter(registry.histogram("optitrack_frame_jitter_seconds", "Deviation of the frame arrival interval from the server interval")),
+                  clientLatency(registry.histogram("optitrack_client_latency_seconds", "Mid-exposure to arrival in the client")),
+                  transitLatency(registry.histogram("optitrack_transit_latency_seconds", "Server transmit to arrival in the client")),
+                  publishLatency(registry.histogram("optitrack_publish_latency_seconds", "Arrival to publication by updateData()")),
+                  backpressure(registry.histogram("optitrack_backpressure_seconds", "Time the receive thread waited for lossless readers")),
+                  resamplerTicks(registry.counter("optitrack_resampler_ticks_total", "Pose tables produced by the resampler timer")),
+                  resamplerMissed(registry.counter("optitrack_resampler_missed_ticks_total", "Resampler ticks skipped because the previous one ran late")),
+                  resampledExtrapolated(registry.counter("optitrack_resampled_samples_total", "Resampled body poses by kind", "kind=\"extrapolated\"")),
+                  resampledHeld(registry.counter("optitrack_resampled_samples_total", "Resampled body poses by kind", "kind=\"held\""))
+            {
+            }
 
-        if (pDiscoveredServer->serverDescription.bConnectionInfoValid) {
-            printf("(%s)\n", pDiscoveredServer->serverDescription.ConnectionMulticast ? "multicast" : "unicast");
-        }
-        else {
-            printf("(WARNING: Legacy server, could not autodetect settings. Auto-connect may not work reliably.)\n");
-        }
+            Counter &framesReceived, &framesDropped, &framesOverwritten, &framesDuplicate, &framesSkipped, &descriptionRefreshes, &reconnects, &poseChanges, &poseChangesCoalesced;
+            Gauge &connected, &queueDepth;
+            Histogram &frameJitter, &clientLatency, &transitLatency, &publishLatency, &backpressure;
+            Counter &resamplerTicks, &resamplerMissed, &resampledExtrapolated, &resampledHeld;
+        };
 
-        discoveredServers.push_back(*pDiscoveredServer);
-    }
+        // Frame ring: a power of two with room for lossless readers beyond the updateData() window
+        constexpr size_t ringCapacity(size_t queueCapacity)
+        {
+            size_t capacity = 64;
+            while (capacity < 2 * queueCapacity)
+                capacity *= 2;
+            return capacity;
+        }
 
-    struct MocapFrameWrapper
-    {
-        std::shared_ptr<sFrameOfMocapData> data;
-        double transitLatencyMillisec;
-        double clientLatencyMillisec;
-    };
+        // The NatNet log callback is process wide, install it only once for all instances of all pipelines
+        inline void initializeNatNet()
+        {
+            static std::once_flag initialized;
+            std::call_once(initialized, []() {
+                // The logger (and its writer thread) is created here rather than on the NatNet thread
+                unsigned char ver[4];
+                NatNet_GetVersion(ver);
+                OPTITRACK_LOG_INFO("NatNet Sample Client (NatNet ver. %d.%d.%d.%d)", ver[0], ver[1], ver[2], ver[3]);
+
+                // Install logging callback
+                NatNet_SetLogCallback(MessageHandler);
+            });
+        }
+    } // namespace detail
 
-    class Optitrack {
+    // NatNet client whose ingest pipeline is fixed at compile time by policies (see Policies.hpp):
+    // ingested categories, pose precision, frame queue and filter stage. Paths of unused categories and
+    // stages are not compiled. Optitrack (below) is the general purpose preset.
+    template <typename... Policies>
+    class BasicOptitrack {
     public:
-        Optitrack(const std::string& address = "")
-        {
-            // print version info
-            unsigned char ver[4];
-            NatNet_GetVersion(ver);
-            printf("NatNet Sample Client (NatNet ver. %d.%d.%d.%d)\n", ver[0], ver[1], ver[2], ver[3]);
+        using Traits = PipelineTraits<Policies...>;
+        using Scalar = typename Traits::Scalar;
+        using Pose = Eigen::Matrix<Scalar, 7, 1>;
+        using FrameRing = BroadcastRing<MocapFrame, detail::ringCapacity(Traits::queueCapacity)>;
+        using FrameReader = typename FrameRing::Reader;
 
-            // Install logging callback
-            NatNet_SetLogCallback(MessageHandler);
+        BasicOptitrack(const std::string& address = "")
+        {
+            detail::initializeNatNet();
 
             _client = std::make_unique<NatNetClient>();
 
             // set the frame callback handler
             _client->SetFrameReceivedCallback(dataHandler, this);
+
+            // The table holds at most MAX_RIGIDBODIES handles and never moves, so poses() views stay valid
+            _poses.reserve(MAX_RIGIDBODIES);
+
+            // Commands are served by their own thread so that callers never block on a round trip
+            _commands = std::make_unique<CommandChannel>(_client.get());
+
+            // Per-body counters live in the pose table, they are read at scrape time
+            _registry.collect([this](std::string& out) { collectBodies(out); });
+
+            // updateData() reads the newest queueCapacity frames like any other reader of the ring
+            _tableReader = _ring.reader(ReadMode::Recent, kQueueCapacity);
+            _arrivals.reserve(kQueueCapacity);
         }
 
-        virtual ~Optitrack()
+        ~BasicOptitrack()
         {
+            _resamplerTimer.reset();
+            _dispatcher.reset();
+            _watchdog.reset();
+            _commands.reset();
             _client->Disconnect();
+            _jitterBuffer.reset();
         }
 
         bool connect(const std::string& server = "", const std::string& local = "")
         {
-            if (server.empty()) {
-                NatNetDiscoveryHandle discovery;
-                NatNet_CreateAsyncServerDiscovery(&discovery, ServerDiscoveredCallback);
-
-                while (const int c = getch()) {
-                    if (c >= '1' && c <= '9') {
-                        const size_t serverIndex = c - '1';
-                        if (serverIndex < discoveredServers.size()) {
-                            const sNatNetDiscoveredServer& discoveredServer = discoveredServers[serverIndex];
-
-                            if (discoveredServer.serverDescription.bConnectionInfoValid) {
-                                // Build the connection parameters.
-                                snprintf(
-                                    _discoveredMulticastGroupAddr, sizeof _discoveredMulticastGroupAddr,
-                                    "%" PRIu8 ".%" PRIu8 ".%" PRIu8 ".%" PRIu8 "",
-                                    discoveredServer.serverDescription.ConnectionMulticastAddress[0],
-                                    discoveredServer.serverDescription.ConnectionMulticastAddress[1],
-                                    discoveredServer.serverDescription.ConnectionMulticastAddress[2],
-                                    discoveredServer.serverDescription.ConnectionMulticastAddress[3]);
-
-                                _connectParams.connectionType = discoveredServer.serverDescription.ConnectionMulticast ? ConnectionType_Multicast : ConnectionType_Unicast;
-                                _connectParams.serverCommandPort = discoveredServer.serverCommandPort;
-                                _connectParams.serverDataPort = discoveredServer.serverDescription.ConnectionDataPort;
-                                _connectParams.serverAddress = discoveredServer.serverAddress;
-                                _connectParams.localAddress = discoveredServer.localAddress;
-                                _connectParams.multicastAddress = _discoveredMulticastGroupAddr;
-                            }
-                            else {
-                                // We're missing some info because it's a legacy server.
-                                // Guess the defaults and make a best effort attempt to connect.
-                                _connectParams.connectionType = ConnectionType_Multicast;
-                                _connectParams.serverCommandPort = discoveredServer.serverCommandPort;
-                                _connectParams.serverDataPort = 0;
-                                _connectParams.serverAddress = discoveredServer.serverAddress;
-                                _connectParams.localAddress = discoveredServer.localAddress;
-                                _connectParams.multicastAddress = NULL;
-                            }
-
-                            break;
-                        }
-                    }
-                    else if (c == 'q') {
-                        return false;
-                    }
-                }
+            if (server.empty())
+                return connect(DiscoveryOptions());
+
+            _connection = ConnectionSettings();
+            _connection.serverAddress = server;
+            _connection.localAddress = local;
 
-                NatNet_FreeAsyncServerDiscovery(discovery);
+            return finishConnect(connectClient());
+        }
+
+        // Headless connection: try the cached server directly while rediscovering in parallel
+        bool connect(const DiscoveryOptions& options)
+        {
+            ConnectionSettings cached;
+            bool haveCache = !options.cachePath.empty() && cached.load(options.cachePath) && options.selector.matches(cached);
+
+            // Rediscovery runs concurrently with the direct attempt and refreshes the cache when it changed
+            std::shared_future<std::vector<sNatNetDiscoveredServer>> discovery = std::async(std::launch::async, discoverServers, options.timeoutMillisec, 16).share();
+
+            if (haveCache) {
+                _connection = cached;
+                if (connectClient() == ErrorCode_OK) {
+                    _discovery = std::async(std::launch::async, [discovery, options, cached]() {
+                        ConnectionSettings settings;
+                        if (selectServer(discovery.get(), options.selector, settings) && settings != cached)
+                            settings.save(options.cachePath);
+                    });
+                    return finishConnect(ErrorCode_OK);
+                }
+                OPTITRACK_LOG_WARN("Cached server %s not reachable, waiting for discovery.", cached.serverAddress.c_str());
             }
-            else {
-                _connectParams.connectionType = ConnectionType_Multicast;
-                _connectParams.serverAddress = server.c_str();
 
-                if (!local.empty())
-                    _connectParams.localAddress = local.c_str();
+            if (!selectServer(discovery.get(), options.selector, _connection)) {
+                OPTITRACK_LOG_ERROR("No matching server discovered within %u ms.", options.timeoutMillisec);
+                return false;
             }
 
-            // Connect to Motive
             int iResult = connectClient();
-            if (iResult != ErrorCode_OK) {
-                printf("Error initializing client. See log for details. Exiting.\n");
-                return false;
+            if (iResult == ErrorCode_OK && !options.cachePath.empty())
+                _connection.save(options.cachePath);
+
+            return finishConnect(iResult);
+        }
+
+        // Server-side data subscription. Takes effect immediately when connected (reconnecting if the
+        // connection parameters change) and is restored on every reconnect.
+        bool subscribe(const Subscription& subscription)
+        {
+            bool reconnect;
+            {
+                std::lock_guard<std::mutex> lock(_descriptionMutex);
+                reconnect = subscription.restricted() != _subscription.restricted() || subscription.bitstreamVersion != _subscription.bitstreamVersion;
+                _subscription = subscription;
+            }
+
+            if (!_connected)
+                return true;
+
+            if (reconnect)
+                return resetClient();
+
+            sendSubscription();
+            return updateDataDescriptions();
+        }
+
+        // Asynchronous NatNet commands; tries/timeout (ms) < 0 use the NatNet defaults
+        std::future<CommandResult> command(const std::string& request, int tries = -1, int timeout = -1)
+        {
+            return _commands->send(request, tries, timeout);
+        }
+
+        void command(const std::string& request, CommandCallback callback, int tries = -1, int timeout = -1)
+        {
+            _commands->send(request, std::move(callback), tries, timeout);
+        }
+
+        std::future<CommandResult> setProperty(const std::string& node, const std::string& property, const std::string& value)
+        {
+            return command("SetProperty," + node + "," + property + "," + value);
+        }
+
+        std::future<CommandResult> getProperty(const std::string& node, const std::string& property)
+        {
+            return command("GetProperty," + node + "," + property);
+        }
+
+        std::future<CommandResult> startRecording() { return command("StartRecording"); }
+
+        std::future<CommandResult> stopRecording() { return command("StopRecording"); }
+
+        void setCommandDefaults(int tries, int timeout) { _commands->setDefaults(tries, timeout); }
+
+        size_t commandsInFlight() { return _commands->inFlight(); }
+
+        // Metadata of the connected server; frame rate and analog samples arrive asynchronously after connect()
+        ServerInfo serverInfo()
+        {
+            std::lock_guard<std::mutex> lock(_serverInfoMutex);
+            return _serverInfo;
+        }
+
+        float frameRate()
+        {
+            std::lock_guard<std::mutex> lock(_serverInfoMutex);
+            return _serverInfo.frameRate;
+        }
+
+        // Reconnect automatically when frames stop arriving
+        void enableWatchdog(const WatchdogOptions& options = WatchdogOptions())
+        {
+            _watchdog = std::make_unique<Watchdog>(
+                [this]() { return _metrics.framesReceived.value(); },
+                [this]() { return frameRate(); },
+                [this]() { return resetClient(); },
+                options);
+
+            std::lock_guard<std::mutex> lock(_realTimeMutex);
+            if (!_realTime.watchdog.empty())
+                realtime::configure(_watchdog->thread().native_handle(), _realTime.watchdog);
+        }
+
+        // Affinity, SCHED_FIFO priority and name of the library's threads, and optionally locked,
+        // prefaulted memory. The NatNet receive thread belongs to the NatNet library, it is configured
+        // from within the frame callback on the next frame (and again whenever NatNet replaces it).
+        // Threads of the application (consumer, publisher, recorder) use realtime::configureCurrentThread.
+        // Returns false when some setting was refused (usually missing privileges), see the log.
+        bool configureRealTime(const RealTimeConfig& config)
+        {
+            bool ok = true;
+            {
+                std::lock_guard<std::mutex> lock(_realTimeMutex);
+                _realTime = config;
+
+                if (!config.commands.empty())
+                    ok &= realtime::configure(_commands->thread().native_handle(), config.commands);
+                if (_watchdog && !config.watchdog.empty())
+                    ok &= realtime::configure(_watchdog->thread().native_handle(), config.watchdog);
+                if (_resamplerTimer && !config.resampler.empty())
+                    ok &= realtime::configure(_resamplerTimer->thread().native_handle(), config.resampler);
+                if (_jitterBuffer && !config.jitterBuffer.empty())
+                    ok &= realtime::configure(_jitterBuffer->thread().native_handle(), config.jitterBuffer);
             }
+
+            {
+                std::lock_guard<std::mutex> lock(_tableMutex);
+                if (_dispatcher && !config.dispatch.empty())
+                    for (std::thread& thread : _dispatcher->threads())
+                        ok &= realtime::configure(thread.native_handle(), config.dispatch);
+            }
+
+            if (config.lockMemory) {
+                ok &= realtime::lockMemory();
+
+                // Flat frame buffers are prefaulted up to the NatNet maxima, nested ones only grow on the
+                // first larger frame; ring slots are reserved by the receive thread as it claims them
+                _reserveSlots = FrameRing::capacity();
+                std::lock_guard<std::mutex> lock(_tableMutex);
+                _lastFrame.template reserve<Traits::categories>();
+            }
+
+            _realTimePending = true;
+            return ok;
+        }
+
+        // Kernel TID of the NatNet receive thread (e.g. for taskset/chrt), 0 before the first frame
+        pid_t natnetThreadId() const { return _natnetTid.load(std::memory_order_relaxed); }
+
+        WatchdogStats watchdogStats() { return _watchdog ? _watchdog->stats() : WatchdogStats(); }
+
+        // Counters, gauges and histograms of this client, e.g. to serve with a MetricsServer (which must
+        // not outlive the client); more metrics can be registered alongside
+        MetricsRegistry& metrics() { return _registry; }
+
+        // Handles are stable indices into the pose table. They are assigned by name, so they can be
+        // resolved before the body is streamed and they survive description refreshes and reconnects.
+        // -1 once the table holds MAX_RIGIDBODIES bodies.
+        int handle(const std::string& bodyName)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            return handleUnlocked(bodyName);
+        }
+
+        // A copy: _names grows as other threads add handles
+        std::string name(int handle)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            return _names[handle];
+        }
+
+        // Filter all bodies at ingest; rigidBody() then returns the filtered table
+        void enableFilter(FilterType type, const FilterParams& params = FilterParams())
+        {
+            static_assert(Traits::filter, "the pipeline has no filter stage");
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            _filter = std::make_unique<FilterBank>(type);
+            _filter->setParams(params);
+        }
+
+        void setFilterParams(int handle, const FilterParams& params)
+        {
+            static_assert(Traits::filter, "the pipeline has no filter stage");
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            if (_filter) {
+                _filter->resize(_poses.size());
+                _filter->setParams(handle, params);
+            }
+        }
+
+        void disableFilter()
+        {
+            static_assert(Traits::filter, "the pipeline has no filter stage");
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            _filter.reset();
+        }
+
+        // Thresholds of the validity gate, for all bodies or for one
+        void setGateParams(const GateParams& params)
+        {
+            static_assert(Traits::gate, "the pipeline has no gate stage");
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            _gate.setParams(params);
+        }
+
+        void setGateParams(int handle, const GateParams& params)
+        {
+            static_assert(Traits::gate, "the pipeline has no gate stage");
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            _gate.resize(_poses.size());
+            _gate.setParams(handle, params);
+        }
+
+        // Validity of the body's sample in the last consumed frame; without a gate only tracking is checked
+        SampleStatus status(int handle)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            if constexpr (Traits::gate)
+                return handle < static_cast<int>(_gate.size()) ? static_cast<SampleStatus>(_gate.status()(handle)) : SampleInvalid;
             else
-                printf("Client initialized and ready.\n");
+                return handle < _accepted.size() && _accepted(handle) ? SampleValid : SampleInvalid;
+        }
 
-            // Send/receive test request
-            void* response;
-            int nBytes;
-            printf("[SampleClient] Sending Test Request\n");
-            iResult = _client->SendMessageAndWait("TestRequest", &response, &nBytes);
-            if (iResult == ErrorCode_OK)
-                printf("[SampleClient] Received: %s\n", (char*)response);
+        DropoutStats dropoutStats(int handle)
+        {
+            static_assert(Traits::gate, "the pipeline has no gate stage");
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            return handle < static_cast<int>(_gate.size()) ? _gate.stats(handle) : DropoutStats();
+        }
 
-            return true;
+        // Zero-copy N x 7 view of the pose table, read without locking: only valid between updateData()
+        // calls of the same thread. The storage never moves, but the view keeps the N bodies known when
+        // it was taken.
+        Eigen::Map<const Eigen::Matrix<Scalar, Eigen::Dynamic, 7, Eigen::RowMajor>> poses() const
+        {
+            return {_poses.empty() ? nullptr : _poses.front().data(), static_cast<Eigen::Index>(_poses.size()), 7};
+        }
+
+        size_t numBodies()
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            return _poses.size();
         }
 
         // const Eigen::MatrixXd& rigidBodies() { return _rigidBodies; }
 
-        Eigen::Matrix<double, 7, 1> rigidBody(const std::string& bodyName)
+        Pose rigidBody(int handle)
         {
-            return _rigidBodies[bodyName];
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            return _poses[handle];
         }
 
-        void updateData()
+        Pose rigidBody(const std::string& bodyName)
         {
-            std::deque<MocapFrameWrapper> displayQueue;
-            if (_networkQueueMutex.try_lock_for(std::chrono::milliseconds(5)))
-            {
-                for (MocapFrameWrapper f : _networkQueue)
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            int handle = handleUnlocked(bodyName);
+            return handle < 0 ? (Pose() << 0, 0, 0, 0, 0, 0, 1).finished() : _poses[handle];
+        }
+
+        // Declare the pose of body relative to reference (T_reference_body), returns the pair index.
+        // All pairs are evaluated together on the first access after each updateData() and cached for
+        // every thread until the next one.
+        int relativePair(int reference, int body)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            int pair = _relative.add(reference, body);
+            _relativeVersion = 0;
+            return pair;
+        }
+
+        // synchronized: both poses come from the same frame (neither body missed the last one)
+        Pose relativePose(int pair, bool* synchronized = nullptr)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            evaluateRelativePoses();
+            if (synchronized)
+                *synchronized = _exposure[_relative.reference(pair)] == _exposure[_relative.body(pair)];
+            return _relative.poses().row(pair).transpose().matrix();
+        }
+
+        // Every declared pair, in pair order
+        void relativePoses(std::vector<Pose>& poses)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            evaluateRelativePoses();
+            poses.resize(_relative.size());
+            for (size_t i = 0; i < poses.size(); i++)
+                poses[i] = _relative.poses().row(i).transpose().matrix();
+        }
+
+        // Seconds since the last frame in which the body was tracked (infinity if never)
+        double age(int handle)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            if (_updated[handle] == std::chrono::steady_clock::time_point())
+                return std::numeric_limits<double>::infinity();
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - _updated[handle]).count();
+        }
+
+        // Camera mid-exposure time of the body's last tracked sample, in local steady_clock time
+        std::chrono::steady_clock::time_point timestamp(int handle)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            return _exposure[handle];
+        }
+
+        // Exposure time of the last frame consumed by updateData()
+        std::chrono::steady_clock::time_point frameTime()
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            return _frameTime;
+        }
+
+        // Error bound (seconds) of timestamp(handle)
+        double timestampError(int handle)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            return _exposureError[handle];
+        }
+
+        // Map a host high resolution timestamp (e.g. CameraMidExposureTimestamp) into local steady_clock time.
+        // Without a host clock frequency (before connect(), pre NatNet 3.0 servers) this is NatNet's raw
+        // estimate, like the frame timestamps, with an infinite error bound.
+        ClockEstimate hostToLocal(uint64_t hostTimestamp)
+        {
+            std::lock_guard<std::mutex> lock(_clockMutex);
+            if (_hostClockFrequency <= 0) {
+                double age = _connected ? _client->SecondsSinceHostTimestamp(hostTimestamp) : 0;
+                return {toSeconds(std::chrono::steady_clock::now()) - age, std::numeric_limits<double>::infinity()};
+            }
+            return _hostClock.predict(hostTimestamp / _hostClockFrequency);
+        }
+
+        // Map the external precision timestamp (e.g. PTP) into local steady_clock time
+        ClockEstimate precisionToLocal(uint32_t seconds, uint32_t fractionalSeconds)
+        {
+            std::lock_guard<std::mutex> lock(_clockMutex);
+            return _precisionClock.predict(precisionSeconds(seconds, fractionalSeconds));
+        }
+
+        // Relative drift of the host clock with respect to the local one
+        double clockDrift()
+        {
+            std::lock_guard<std::mutex> lock(_clockMutex);
+            return _hostClock.drift();
+        }
+
+        static std::chrono::steady_clock::time_point toTimePoint(double seconds)
+        {
+            return std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds)));
+        }
+
+        static double toSeconds(std::chrono::steady_clock::time_point time)
+        {
+            return std::chrono::duration<double>(time.time_since_epoch()).count();
+        }
+
+        // Copy the whole pose table under a single lock
+        void table(std::vector<Pose>& poses, std::vector<std::chrono::steady_clock::time_point>& timestamps, std::vector<std::string>* names = nullptr, std::vector<uint8_t>* status = nullptr)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            poses = _poses;
+            timestamps = _exposure;
+            if (names)
+                *names = _names;
+            if (status) {
+                status->assign(_poses.size(), SampleInvalid);
+                if constexpr (Traits::gate)
+                    std::copy(_gate.status().data(), _gate.status().data() + _gate.size(), status->begin());
+                else
+                    for (Eigen::Index h = 0; h < _accepted.size(); h++)
+                        (*status)[h] = _accepted(h) ? SampleValid : SampleInvalid;
+            }
+        }
+
+        // Feed frames and descriptions from another source than the NatNet client (replay, synthetic data);
+        // frames injected while disconnected are stamped at arrival
+        void injectFrame(sFrameOfMocapData* data) { storeFrames(data); }
+
+        void injectDescriptions(sDataDescriptions* descriptions)
+        {
+            std::lock_guard<std::mutex> lock(_descriptionMutex);
+            if (descriptions)
+                applyDescriptions(DescriptionCache::build(*descriptions, _serverKey));
+        }
+
+        // Persist the descriptions in path (one server at a time) and, when the cached ones belong to
+        // the server being connected, apply them right after the connection so that frames resolve to
+        // handles while the description request is still in flight. Handles are bound by name, so a
+        // stale cache at worst maps a renumbered body for the frames before the fresh descriptions.
+        void enableDescriptionCache(const std::string& path)
+        {
+            std::lock_guard<std::mutex> lock(_descriptionMutex);
+            _descriptionCachePath = path;
+        }
+
+        // Current descriptions (cached or received), nullptr before any
+        std::shared_ptr<const DescriptionCache> descriptions()
+        {
+            std::lock_guard<std::mutex> lock(_descriptionMutex);
+            return _descriptions;
+        }
+
+        // Block until a frame newer than those consumed by updateData() arrives; false on timeout
+        bool waitForFrame(std::chrono::milliseconds timeout) { return _tableReader.wait(timeout); }
+
+        // Independent view of the ingested frames for one consumer thread (recorder, publisher, second
+        // control loop), next to updateData() and the other readers: every frame (Lossless) or the
+        // newest `window` ones per poll (Recent). Frames are read in place from the ring:
+        //
+        //     auto reader = client.reader(ReadMode::Lossless);
+        //     while (reader.wait(100ms))
+        //         reader.poll([&](const MocapFrame& frame) { record(frame); });
+        //
+        // A lossless reader that falls a whole ring behind makes the receive thread wait for it (up to
+        // 5 ms, see optitrack_backpressure_seconds) and then drop frames for everyone
+        // (optitrack_frames_dropped_total). The reader must not outlive the client.
+        FrameReader reader(ReadMode mode = ReadMode::Lossless, size_t window = 1) { return _ring.reader(mode, window); }
+
+        // Re-pace frames by camera exposure time before they reach updateData() and the readers:
+        // frames are put back in order and released at the exposure spacing, delayed by the measured
+        // jitter quantile (see JitterBuffer). For consumers that differentiate poses over their arrival
+        // times. Call once, before connect() or the first injectFrame().
+        void enableJitterBuffer(const JitterBufferOptions& options = JitterBufferOptions())
+        {
+            if (_jitterBuffer) {
+                OPTITRACK_LOG_WARN("The jitter buffer is already enabled");
+                return;
+            }
+
+            _jitterBuffer = std::make_unique<JitterBuffer<MocapFrame>>(options, [this](MocapFrame& frame) { releaseFrame(frame); });
+            _registry.collect([this](std::string& out) { collectJitterBuffer(out); });
+
+            std::lock_guard<std::mutex> lock(_realTimeMutex);
+            if (!_realTime.jitterBuffer.empty())
+                realtime::configure(_jitterBuffer->thread().native_handle(), _realTime.jitterBuffer);
+        }
+
+        JitterBufferStats jitterBufferStats() { return _jitterBuffer ? _jitterBuffer->stats() : JitterBufferStats(); }
+
+#ifdef OPTITRACK_COROUTINES
+        // Coroutine waits (C++20). Awaiting coroutines resume through the executor, by default right
+        // on the thread that completes the wait (see Executor); set it before the first co_await.
+        void setExecutor(Executor executor) { _executor = std::move(executor); }
+
+        // co_await client.nextFrame(): a frame newer than those consumed by updateData() arrived.
+        // Resumed from the receive thread as soon as the frame is published.
+        auto nextFrame()
+        {
+            struct Awaiter {
+                BasicOptitrack* self;
+
+                bool await_ready() const { return self->_tableReader.lag() > 0; }
+
+                bool await_suspend(std::coroutine_handle<> coroutine)
                 {
-                    displayQueue.push_back(f);
+                    return self->_frameAwaiters.suspend(coroutine, &self->_executor, [this]() { return self->_tableReader.lag() > 0; });
                 }
 
-                // Release all frames in network queue
-                _networkQueue.clear();
-                _networkQueueMutex.unlock();
-            }
-            
-            for (MocapFrameWrapper f : displayQueue)
-            {
-                sFrameOfMocapData* data = f.data.get();
-                _rigidBodies.clear();
+                void await_resume() const {}
+            };
+            return Awaiter{this};
+        }
+
+        struct StampedPose {
+            Pose pose;
+            std::chrono::steady_clock::time_point exposure;
+        };
+
+        // co_await client.poseAfter(handle, t): the first pose of the body published by updateData()
+        // with an exposure time at or after t (see timestamp()), resumed from updateData()
+        auto poseAfter(int handle, std::chrono::steady_clock::time_point time)
+        {
+            struct Awaiter {
+                BasicOptitrack* self;
+                int handle;
+                std::chrono::steady_clock::time_point time;
+                StampedPose result;
+
+                bool await_ready()
+                {
+                    std::lock_guard<std::mutex> lock(self->_tableMutex);
+                    return self->resolvePose(handle, time, result);
+                }
 
-                // printf("Rigid Bodies [Count=%d]\n", data->nRigidBodies);
-                for (int i = 0; i < data->nRigidBodies; i++)
+                bool await_suspend(std::coroutine_handle<> coroutine)
                 {
-                    
-
-                    int streamingID = data->RigidBodies[i].ID;
-                    Eigen::Matrix<double, 7, 1> pose = (Eigen::Matrix<double, 7, 1>() << data->RigidBodies[i].x, data->RigidBodies[i].y, data->RigidBodies[i].z, data->RigidBodies[i].qx, data->RigidBodies[i].qy, data->RigidBodies[i].qz, data->RigidBodies[i].qw).finished();
-
-                    std::pair<std::map<std::string, Eigen::Matrix<double, 7, 1>>::iterator, bool> insertResult;
-                    insertResult = _rigidBodies.insert(std::pair<std::string, Eigen::Matrix<double, 7, 1>>(_assetIDtoAssetName[streamingID], pose));
-
-                    // // params
-                    // // 0x01 : bool, rigid body was successfully tracked in this frame
-                    // bool bTrackingValid = data->RigidBodies[i].params & 0x01;
-                    // // int streamingID = data->RigidBodies[i].ID;
-                    // printf("%s [ID=%d  Error(mm)=%.5f  Tracked=%d]\n", _assetIDtoAssetName[streamingID].c_str(), streamingID, data->RigidBodies[i].MeanError*1000.0f, bTrackingValid);
-                    // printf("\tx\ty\tz\tqx\tqy\tqz\tqw\n");
-                    // printf("\t%3.2f\t%3.2f\t%3.2f\t%3.2f\t%3.2f\t%3.2f\t%3.2f\n",
-                    //     data->RigidBodies[i].x,
-                    //     data->RigidBodies[i].y,
-                    //     data->RigidBodies[i].z,
-                    //     data->RigidBodies[i].qx,
-                    //     data->RigidBodies[i].qy,
-                    //     data->RigidBodies[i].qz,
-                    //     data->RigidBodies[i].qw);
-                    // std::this_thread::sleep_for(5ms);
+                    std::lock_guard<std::mutex> lock(self->_tableMutex);
+                    if (self->resolvePose(handle, time, result))
+                        return false;
+                    self->_poseAwaiters.push_back({handle, time, coroutine, &result});
+                    return true;
                 }
+
+                StampedPose await_resume() const { return result; }
+            };
+            return Awaiter{this, handle, time, StampedPose()};
+        }
+
+        // co_await client.awaitCommand("FrameRate"): the CommandResult, resumed from the command thread
+        auto awaitCommand(std::string request, int tries = -1, int timeout = -1)
+        {
+            struct Awaiter {
+                BasicOptitrack* self;
+                std::string request;
+                int tries, timeout;
+                CommandResult result;
+
+                bool await_ready() const { return false; }
+
+                void await_suspend(std::coroutine_handle<> coroutine)
+                {
+                    self->command(request, [this, coroutine](const CommandResult& r) {
+                        result = r;
+                        self->_executor(coroutine);
+                    }, tries, timeout);
+                }
+
+                CommandResult await_resume() { return std::move(result); }
+            };
+            return Awaiter{this, std::move(request), tries, timeout, CommandResult()};
+        }
+#endif
+
+        // Keep the last samples accepted for each body
+        void enableHistory(size_t samples = 1024)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            _history = std::make_unique<PoseHistory>(samples);
+        }
+
+        // Accepted samples of the body with exposure time (steady_clock seconds) in [from, to], oldest first
+        std::vector<PoseSample> history(int handle, double from, double to)
+        {
+            std::vector<PoseSample> samples;
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            if (_history)
+                _history->window(handle, from, to, samples);
+            return samples;
+        }
+
+        // Pose table of all bodies at an exact time (steady_clock), from the accepted history: for
+        // controllers ticking on their own clock. Enables a short history on first use.
+        void resample(Resampler& resampler, std::chrono::steady_clock::time_point time)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            if (!_history)
+                _history = std::make_unique<PoseHistory>(kResamplerHistory);
+            resampler.sample(*_history, _poses.size(), toSeconds(time));
+        }
+
+        using ResampleCallback = std::function<void(const Resampler&)>;
+
+        // Uniform-cadence pose stream: a timer thread at options.rate samples the table at each tick
+        // minus options.delay (see Resampler) and passes it to the callback, on the timer thread.
+        // Replaces a running resampler; the callback must return within the tick period.
+        void startResampler(const ResamplerOptions& options, ResampleCallback callback)
+        {
+            stopResampler();
+            _resampler.setOptions(options);
+            _resamplerTimer = std::make_unique<ResampleTimer>(options.rate, [this, callback = std::move(callback)](std::chrono::steady_clock::time_point tick, uint64_t missed) {
+                OPTITRACK_TRACE_SCOPE("resample");
+                const ResamplerOptions& options = _resampler.options();
+                if (options.update)
+                    updateData();
+                resample(_resampler, tick - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options.delay)));
+
+                _metrics.resamplerTicks.add();
+                _metrics.resamplerMissed.add(missed);
+                _metrics.resampledExtrapolated.add(_resampler.count(SampleKind::Extrapolated));
+                _metrics.resampledHeld.add(_resampler.count(SampleKind::Held));
+                callback(_resampler);
+            });
+
+            std::lock_guard<std::mutex> lock(_realTimeMutex);
+            if (!_realTime.resampler.empty())
+                realtime::configure(_resamplerTimer->thread().native_handle(), _realTime.resampler);
+        }
+
+        void stopResampler() { _resamplerTimer.reset(); }
+
+        using PoseCallback = typename PoseDispatcher<Pose>::Callback;
+
+        // Call back when the body moves more than translationDeadband (m) or rotationDeadband (rad) from
+        // the pose of the previous call; the first tracked sample always calls back. The test runs in
+        // updateData(), callbacks run on the dispatch threads with the latest pose only. Returns a
+        // listener id for removePoseListener().
+        int onPoseChanged(int handle, double translationDeadband, double rotationDeadband, PoseCallback callback)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            if (!_dispatcher) {
+                _dispatcher = std::make_unique<PoseDispatcher<Pose>>(_dispatchThreads);
+                std::lock_guard<std::mutex> realTimeLock(_realTimeMutex);
+                for (std::thread& thread : _dispatcher->threads())
+                    if (!_realTime.dispatch.empty())
+                        realtime::configure(thread.native_handle(), _realTime.dispatch);
             }
+
+            _dispatcher->add(handle, std::move(callback));
+            return _changes.add(handle, static_cast<float>(translationDeadband), static_cast<float>(rotationDeadband));
+        }
+
+        // A callback already running completes; unknown ids are ignored
+        void removePoseListener(int listener)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            if (!_dispatcher || listener < 0 || static_cast<size_t>(listener) >= _changes.size())
+                return;
+
+            _changes.remove(listener);
+            _dispatcher->remove(listener);
+        }
+
+        // Size of the callback pool, before the first onPoseChanged()
+        void setDispatchThreads(size_t threads) { _dispatchThreads = threads; }
+
+        // Body solved on the client from labeled markers (e.g. MarkerTemplate::fromDescription with
+        // custom weights, or markers of a marker set); its pose is published under template.name like a
+        // streamed body, through the same gate and filter. Returns its handle, -1 when the body has fewer
+        // than SolverParams::minMarkers markers of its own.
+        int addSolvedBody(const MarkerTemplate& body)
+        {
+            static_assert(Traits::ingests(LabeledMarkers) && Traits::ingests(RigidBodies), "the pipeline ingests no labeled markers or rigid bodies");
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            int handle = handleUnlocked(body.name);
+            if (handle < 0)
+                return -1;
+
+            if (!_solver)
+                _solver = std::make_unique<MarkerSolver>();
+            if (_solver->add(body) < 0)
+                return -1;
+            _solvedHandles.push_back(handle);
+            return handle;
+        }
+
+        void setSolverParams(const SolverParams& params)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            if (!_solver)
+                _solver = std::make_unique<MarkerSolver>();
+            _solver->setParams(params);
+        }
+
+        // Fit quality of a client-side body in the last consumed frame
+        SolvedBodyStats solverStats(int handle)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            for (size_t i = 0; i < _solvedHandles.size(); i++)
+                if (_solvedHandles[i] == handle)
+                    return _solver->stats(i);
+            return SolvedBodyStats();
+        }
+
+        // Zones and rules are evaluated in updateData() for every consumed frame
+        int addZone(const Zone& zone)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            return zoneEngine().addZone(zone);
+        }
+
+        // -1 when rule.zone is not a zone index
+        int addZoneRule(const ZoneRule& rule)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            return zoneEngine().addRule(rule);
+        }
+
+        // Next enter/exit event, lock-free; any thread may poll
+        bool pollZoneEvent(ZoneEvent& event)
+        {
+            ZoneEngine* zones = _zoneEvents.load(std::memory_order_acquire);
+            return zones && zones->poll(event);
+        }
+
+        // Events lost because nobody polled them in time
+        uint64_t zoneEventsDropped()
+        {
+            ZoneEngine* zones = _zoneEvents.load(std::memory_order_acquire);
+            return zones ? zones->dropped() : 0;
+        }
+
+        // Last frame consumed by updateData(), with every ingested category
+        MocapFrame lastFrame()
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            return _lastFrame;
+        }
+
+        void updateData()
+        {
+            OPTITRACK_TRACE_SCOPE("updateData");
+            std::unique_lock<std::mutex> lock(_tableMutex);
+
+            // The newest frames, read in place; older ones were overwritten for this reader
+            uint64_t skipped = _tableReader.skipped();
+            size_t frames = _tableReader.poll([this](const MocapFrame& f, bool newest) {
+                OPTITRACK_TRACE_SCOPE("updatePoses", f.iFrame);
+                _frameTime = f.exposureTime;
+
+                if constexpr (Traits::ingests(RigidBodies))
+                    updatePoses(f);
+
+                _arrivals.push_back(f.receivedAt);
+                if (newest)
+                    _lastFrame = f;
+            });
+            _metrics.framesOverwritten.add(_tableReader.skipped() - skipped);
+            _metrics.queueDepth.set(0);
+
+            auto now = std::chrono::steady_clock::now();
+            for (auto arrival : _arrivals)
+                _metrics.publishLatency.observe(std::chrono::duration<double>(now - arrival).count());
+            _arrivals.clear();
+
+            if (frames)
+                _tableVersion++;
+
+#ifdef OPTITRACK_COROUTINES
+            // Resume outside of the lock, inline executors may read the table right away
+            if (frames && !_poseAwaiters.empty()) {
+                std::vector<std::coroutine_handle<>> ready;
+                for (size_t i = 0; i < _poseAwaiters.size();) {
+                    PoseAwaiter& awaiter = _poseAwaiters[i];
+                    if (resolvePose(awaiter.handle, awaiter.time, *awaiter.result)) {
+                        ready.push_back(awaiter.coroutine);
+                        awaiter = _poseAwaiters.back();
+                        _poseAwaiters.pop_back();
+                    }
+                    else
+                        i++;
+                }
+                lock.unlock();
+                for (std::coroutine_handle<> coroutine : ready)
+                    _executor(coroutine);
+            }
+#endif
         }
 
         bool updateDataDescriptions()
         {
-            // release memory allocated by previous in previous GetDataDescriptionList()
-            if (_descriptionFrame)
-                NatNet_FreeDescriptions(_descriptionFrame);
+            OPTITRACK_TRACE_SCOPE("updateDataDescriptions");
+            std::lock_guard<std::mutex> lock(_descriptionMutex);
 
-            // Retrieve Data Descriptions from Motive
-            int iResult = _client->GetDataDescriptionList(&_descriptionFrame);
-            if (iResult != ErrorCode_OK || _descriptionFrame == NULL)
+            // Retrieve Data Descriptions from Motive; only the compact copy is kept
+            sDataDescriptions* descriptionFrame = nullptr;
+            int iResult = _client->GetDataDescriptionList(&descriptionFrame);
+            if (iResult != ErrorCode_OK || descriptionFrame == NULL)
                 return false;
 
-            updateDataToDescriptionMaps(_descriptionFrame);
+            std::shared_ptr<const DescriptionCache> descriptions = DescriptionCache::build(*descriptionFrame, _serverKey);
+            NatNet_FreeDescriptions(descriptionFrame);
+
+            bool changed = !_descriptions || *_descriptions != *descriptions;
+            applyDescriptions(descriptions);
+
+            if (changed && !_descriptionCachePath.empty() && !descriptions->save(_descriptionCachePath))
+                OPTITRACK_LOG_WARN("Unable to write the description cache %s", _descriptionCachePath.c_str());
 
             return true;
         }
 
     protected:
         std::unique_ptr<NatNetClient> _client;
+        ConnectionSettings _connection;
         sNatNetClientConnectParams _connectParams;
-        char _discoveredMulticastGroupAddr[kNatNetIpv4AddrStrLenMax] = NATNET_DEFAULT_MULTICAST_ADDRESS;
-        int _analogSamplesPerMocapFrame = 0;
-        sServerDescription _serverDescription;
-        
-        std::map<std::string, Eigen::Matrix<double,7,1>> _rigidBodies;
+        std::atomic<bool> _connected{false};
+
+        // Subscription (guarded by _descriptionMutex) and the categories it lets through at runtime
+        Subscription _subscription;
+        std::atomic<uint32_t> _ingest{AllCategories};
+        std::future<void> _discovery;
+        std::unique_ptr<CommandChannel> _commands;
+        std::mutex _serverInfoMutex;
+        ServerInfo _serverInfo;
+        // Host (and precision) clock to local steady_clock, updated once per frame
+        std::mutex _clockMutex;
+        ClockModel _hostClock, _precisionClock;
+        double _hostClockFrequency = 0;
+
+        std::unique_ptr<Watchdog> _watchdog;
+
+        // Real-time settings, the receive thread applies its part when _realTimePending is set
+        std::mutex _realTimeMutex;
+        RealTimeConfig _realTime;
+        std::atomic<bool> _realTimePending{false};
+        std::atomic<pid_t> _natnetTid{0};
+
+        MetricsRegistry _registry;
+        detail::ClientMetrics _metrics{_registry};
+        // Frame continuity, receive thread only
+        int32_t _lastFrameNumber = 0;
+        double _lastServerTime = 0;
+        std::chrono::steady_clock::time_point _lastArrival;
+
+        // Pose table indexed by handle
+        std::mutex _tableMutex;
+        std::unordered_map<std::string, int> _handles;
+        std::unordered_map<int, int> _streamingIDtoHandle;
+        std::vector<std::string> _names;
+        std::vector<Pose> _poses;
+        std::vector<std::chrono::steady_clock::time_point> _updated, _exposure;
+        std::vector<double> _exposureError;
+        std::vector<uint64_t> _bodyFrames, _bodyLost;
+        std::chrono::steady_clock::time_point _frameTime;
+        MocapFrame _lastFrame;
+
+        // Per-frame structure-of-arrays input of the gating and filter stages
+        FilterBank::Poses _measurements;
+        FilterBank::Mask _tracked, _accepted;
+        FilterBank::Array _meanError, _dt;
+
+        std::conditional_t<Traits::gate, GateBank, detail::Disabled> _gate;
+        std::conditional_t<Traits::filter, std::unique_ptr<FilterBank>, detail::Disabled> _filter;
+        std::unique_ptr<PoseHistory> _history;
+
+        // Fixed-rate resampling; _resampler is only used by the timer thread
+        static constexpr size_t kResamplerHistory = 64;
+        Resampler _resampler;
+        std::unique_ptr<ResampleTimer> _resamplerTimer;
+
+        // Relative pose pairs, evaluated at most once per table version (guarded by _tableMutex)
+        RelativePoseBank<Scalar> _relative;
+        uint64_t _tableVersion = 1, _relativeVersion = 0;
+
+        // Client-side bodies (guarded by _tableMutex), indexed like the solver's bodies
+        std::unique_ptr<MarkerSolver> _solver;
+        std::vector<int> _solvedHandles;
+
+        // Zone engine (guarded by _tableMutex), published for lock-free event polling once created
+        std::unique_ptr<ZoneEngine> _zones;
+        std::atomic<ZoneEngine*> _zoneEvents{nullptr};
+
+        // Pose listeners (guarded by _tableMutex) and the pool running their callbacks
+        ChangeBank _changes;
+        std::unique_ptr<PoseDispatcher<Pose>> _dispatcher;
+        size_t _dispatchThreads = 2;
         // Eigen::MatrixXd _rigidBodies;
 
         // // DataHandler receives data from the server
@@ -260,271 +1058,560 @@ namespace optitrack_lib {
         //     }
         // }
 
+        // Sample bookkeeping of body h in frame f (the pose row is written by the caller)
+        void measure(int h, const MocapFrame& f, bool tracked, float meanError)
+        {
+            _tracked(h) = tracked;
+            _bodyFrames[h]++;
+            _bodyLost[h] += !tracked;
+
+            if constexpr (Traits::gate)
+                _meanError(h) = meanError;
+
+            // Time since the last accepted sample
+            if constexpr (Traits::gate || Traits::filter)
+                if (_exposure[h] != std::chrono::steady_clock::time_point())
+                    _dt(h) = std::chrono::duration<float>(f.exposureTime - _exposure[h]).count();
+        }
+
+        // Created on first use; call with _tableMutex held
+        ZoneEngine& zoneEngine()
+        {
+            if (!_zones) {
+                _zones = std::make_unique<ZoneEngine>();
+                _zoneEvents = _zones.get();
+            }
+            return *_zones;
+        }
+
+        // Call with _tableMutex held
+        void evaluateRelativePoses()
+        {
+            if (_relativeVersion == _tableVersion)
+                return;
+
+            OPTITRACK_TRACE_SCOPE("relativePoses");
+            _relative.evaluate(poses());
+            _relativeVersion = _tableVersion;
+        }
+
+        // Gate, filter and store the rigid bodies of one frame
+        void updatePoses(const MocapFrame& f)
+        {
+            // Structure-of-arrays view of the frame; bodies missing from it stay untracked
+            Eigen::Index n = _poses.size();
+            _measurements.resize(n, 7);
+            _tracked.setConstant(n, false);
+            if constexpr (Traits::gate)
+                _meanError.setZero(n);
+            if constexpr (Traits::gate || Traits::filter)
+                _dt.setZero(n);
+
+            for (const sRigidBodyData& body : f.rigidBodies)
+            {
+                auto handle = _streamingIDtoHandle.find(body.ID);
+                if (handle == _streamingIDtoHandle.end())
+                    continue;
+
+                // 0x01 : bool, rigid body was successfully tracked in this frame
+                measure(handle->second, f, body.params & 0x01, body.MeanError);
+                _measurements.row(handle->second) << body.x, body.y, body.z, body.qx, body.qy, body.qz, body.qw;
+            }
+
+            // Client-side bodies enter the gate and filter like streamed ones, the residual as mean error
+            if constexpr (Traits::ingests(LabeledMarkers))
+                if (_solver) {
+                    OPTITRACK_TRACE_SCOPE("solveMarkers", f.iFrame);
+                    const MarkerSolver::Poses& solved = _solver->solve(f.labeledMarkers);
+                    for (size_t i = 0; i < _solvedHandles.size(); i++) {
+                        const SolvedBodyStats& stats = _solver->stats(i);
+                        measure(_solvedHandles[i], f, stats.valid, static_cast<float>(stats.residual));
+                        _measurements.row(_solvedHandles[i]) = solved.row(i).template cast<float>();
+                    }
+                }
+
+            // Gate all bodies at once; rejected samples leave the table (and the body's age) untouched
+            if constexpr (Traits::gate) {
+                const GateBank::Status& status = _gate.update(_measurements, _tracked, _meanError, _dt);
+                _accepted = status.head(n) == uint8_t(SampleValid);
+            }
+            else
+                _accepted = _tracked;
+
+            // One filter pass per frame for all bodies
+            const FilterBank::Poses* output = &_measurements;
+            if constexpr (Traits::filter)
+                if (_filter) {
+                    _filter->update(_measurements, _accepted, _dt);
+                    output = &_filter->poses();
+                }
+
+            for (Eigen::Index h = 0; h < n; h++)
+                if (_accepted(h)) {
+                    _poses[h] = output->row(h).transpose().matrix().template cast<Scalar>();
+                    if (_history)
+                        _history->push(h, toSeconds(f.exposureTime), _poses[h]);
+                    _updated[h] = f.receivedAt;
+                    _exposure[h] = f.exposureTime;
+                    _exposureError[h] = f.exposureErrorBound;
+                }
+
+            if (_zones) {
+                OPTITRACK_TRACE_SCOPE("zones", f.iFrame);
+                _zones->update(poses(), _accepted, f.iFrame, f.exposureTime);
+            }
+
+            // Deadband test of all listeners at once, the few that fire are handed to the dispatcher
+            if (!_changes.empty())
+                for (int listener : _changes.update(*output, _accepted)) {
+                    int h = _changes.handle(listener);
+                    _metrics.poseChanges.add();
+                    if (!_dispatcher->post(listener, _poses[h], _exposure[h]))
+                        _metrics.poseChangesCoalesced.add();
+                }
+        }
+
+        bool finishConnect(int iResult)
+        {
+            if (iResult != ErrorCode_OK) {
+                OPTITRACK_LOG_ERROR("Error initializing client. See log for details.");
+                return false;
+            }
+            else
+                OPTITRACK_LOG_INFO("Client initialized and ready.");
+
+            // Send/receive test request
+            OPTITRACK_LOG_DEBUG("Sending Test Request");
+            command("TestRequest", [](const CommandResult& result) {
+                if (result.ok())
+                    OPTITRACK_LOG_DEBUG("Test Request received: %s", result.str().c_str());
+            });
+
+            return true;
+        }
+
         // Establish a NatNet Client connection
         int connectClient()
         {
             // Release previous server
+            _connected = false;
+            _metrics.connected.set(0);
             _client->Disconnect();
 
+            // Frame numbers of the new connection may start over
+            if (_jitterBuffer)
+                _jitterBuffer->reset();
+
             // Init Client and connect to NatNet server
+            _connectParams = _connection.params();
+            {
+                std::lock_guard<std::mutex> lock(_descriptionMutex);
+                _connectParams.subscribedDataOnly = _subscription.restricted();
+                std::copy(_subscription.bitstreamVersion.begin(), _subscription.bitstreamVersion.end(), _connectParams.BitstreamVersion);
+            }
             int retCode = _client->Connect(_connectParams);
             if (retCode != ErrorCode_OK) {
-                printf("Unable to connect to server.  Error code: %d. Exiting.\n", retCode);
+                OPTITRACK_LOG_ERROR("Unable to connect to server. Error code: %d.", retCode);
                 return ErrorCode_Internal;
             }
             else {
                 // connection succeeded
-
-                void* pResult;
-                int nBytes = 0;
-                ErrorCode ret = ErrorCode_OK;
+                sServerDescription serverDescription;
+                memset(&serverDescription, 0, sizeof(serverDescription));
 
                 // print server info
-                memset(&_serverDescription, 0, sizeof(_serverDescription));
-                ret = _client->GetServerDescription(&_serverDescription);
-                if (ret != ErrorCode_OK || !_serverDescription.HostPresent) {
-                    printf("Unable to connect to server. Host not present. Exiting.\n");
+                ErrorCode ret = _client->GetServerDescription(&serverDescription);
+                if (ret != ErrorCode_OK || !serverDescription.HostPresent) {
+                    OPTITRACK_LOG_ERROR("Unable to connect to server. Host not present.");
                     return 1;
                 }
-                printf("\n[SampleClient] Server application info:\n");
-                printf("Application: %s (ver. %d.%d.%d.%d)\n", _serverDescription.szHostApp, _serverDescription.HostAppVersion[0],
-                    _serverDescription.HostAppVersion[1], _serverDescription.HostAppVersion[2], _serverDescription.HostAppVersion[3]);
-                printf("NatNet Version: %d.%d.%d.%d\n", _serverDescription.NatNetVersion[0], _serverDescription.NatNetVersion[1],
-                    _serverDescription.NatNetVersion[2], _serverDescription.NatNetVersion[3]);
-                printf("Client IP:%s\n", _connectParams.localAddress);
-                printf("Server IP:%s\n", _connectParams.serverAddress);
-                printf("Server Name:%s\n", _serverDescription.szHostComputerName);
-
-                // get mocap frame rate
-                ret = _client->SendMessageAndWait("FrameRate", &pResult, &nBytes);
-                if (ret == ErrorCode_OK) {
-                    float fRate = *((float*)pResult);
-                    printf("Mocap Framerate : %3.2f\n", fRate);
+                OPTITRACK_LOG_INFO("Server application: %s (ver. %d.%d.%d.%d), NatNet %d.%d.%d.%d", serverDescription.szHostApp,
+                    serverDescription.HostAppVersion[0], serverDescription.HostAppVersion[1], serverDescription.HostAppVersion[2], serverDescription.HostAppVersion[3],
+                    serverDescription.NatNetVersion[0], serverDescription.NatNetVersion[1], serverDescription.NatNetVersion[2], serverDescription.NatNetVersion[3]);
+                OPTITRACK_LOG_INFO("Client IP: %s, Server IP: %s, Server Name: %s", _connectParams.localAddress ? _connectParams.localAddress : "",
+                    _connectParams.serverAddress ? _connectParams.serverAddress : "", serverDescription.szHostComputerName);
+
+                {
+                    std::lock_guard<std::mutex> lock(_serverInfoMutex);
+                    _serverInfo = ServerInfo();
+                    _serverInfo.description = serverDescription;
                 }
-                else
-                    printf("Error getting frame rate.\n");
 
-                // get # of analog samples per mocap frame of data
-                ret = _client->SendMessageAndWait("AnalogSamplesPerMocapFrame", &pResult, &nBytes);
-                if (ret == ErrorCode_OK) {
-                    _analogSamplesPerMocapFrame = *((int*)pResult);
-                    printf("Analog Samples Per Mocap Frame : %d\n", _analogSamplesPerMocapFrame);
+                warmStart(serverKey(serverDescription));
+
+                // A new connection may be a different host clock
+                {
+                    std::lock_guard<std::mutex> lock(_clockMutex);
+                    _hostClockFrequency = static_cast<double>(serverDescription.HighResClockFrequency);
+                    _hostClock.reset();
+                    _precisionClock.reset();
                 }
-                else
-                    printf("Error getting Analog frame rate.\n");
+
+                // get mocap frame rate and # of analog samples per mocap frame; both are queued at once and sent back to back
+                command("FrameRate", [this](const CommandResult& result) {
+                    if (result.ok()) {
+                        std::lock_guard<std::mutex> lock(_serverInfoMutex);
+                        _serverInfo.frameRate = result.as<float>();
+                        OPTITRACK_LOG_INFO("Mocap Framerate : %3.2f", _serverInfo.frameRate);
+                    }
+                    else
+                        OPTITRACK_LOG_WARN("Error getting frame rate.");
+                });
+
+                command("AnalogSamplesPerMocapFrame", [this](const CommandResult& result) {
+                    if (result.ok()) {
+                        std::lock_guard<std::mutex> lock(_serverInfoMutex);
+                        _serverInfo.analogSamplesPerMocapFrame = result.as<int>();
+                        OPTITRACK_LOG_INFO("Analog Samples Per Mocap Frame : %d", _serverInfo.analogSamplesPerMocapFrame);
+                    }
+                    else
+                        OPTITRACK_LOG_WARN("Error getting Analog frame rate.");
+                });
+
+                sendSubscription();
+                _connected = true;
+                _metrics.connected.set(1);
             }
 
             return ErrorCode_OK;
         }
 
+        void sendSubscription()
+        {
+            std::vector<std::string> commands;
+            uint32_t ingest = 0;
+            {
+                std::lock_guard<std::mutex> lock(_descriptionMutex);
+                commands = _subscription.commands();
+
+                ingest = _subscription.categories();
+            }
+            _ingest = ingest;
+
+            for (const auto& request : commands)
+                command(request, [request](const CommandResult& result) {
+                    if (!result.ok())
+                        OPTITRACK_LOG_WARN("Error sending subscription command %s.", request.c_str());
+                });
+        }
+
         void storeFrames(sFrameOfMocapData* data)
         {
             if (!_client)
                 return;
-   
-            std::shared_ptr<sFrameOfMocapData> pDataCopy = std::make_shared<sFrameOfMocapData>();
-            NatNet_CopyFrame(data, pDataCopy.get());
-
-            MocapFrameWrapper f;
-            f.data = pDataCopy;
-            f.clientLatencyMillisec = _client->SecondsSinceHostTimestamp(data->CameraMidExposureTimestamp) * 1000.0;
-            f.transitLatencyMillisec = _client->SecondsSinceHostTimestamp(data->TransmitTimestamp) * 1000.0;
 
-            if (_networkQueueMutex.try_lock_for(std::chrono::milliseconds(5)))
-            {
-                _networkQueue.push_back(f);
+            _metrics.framesReceived.add();
+            OPTITRACK_TRACE_FRAME(data->iFrame);
+            OPTITRACK_TRACE_SCOPE("storeFrames", data->iFrame);
+
+            // Arrival and the NatNet latencies are sampled together, before the ring claim that may wait
+            // for a reader, so that updateClocks() and the jitter metrics see one instant
+            bool live = _connected;
+            auto receivedAt = std::chrono::steady_clock::now();
+            double clientLatency = live ? _client->SecondsSinceHostTimestamp(data->CameraMidExposureTimestamp) * 1000.0 : 0;
+            double transitLatency = live ? _client->SecondsSinceHostTimestamp(data->TransmitTimestamp) * 1000.0 : 0;
+            if (_lastArrival != std::chrono::steady_clock::time_point()) {
+                int32_t gap = data->iFrame - _lastFrameNumber;
+                if (gap <= 0)
+                    _metrics.framesDuplicate.add();
+                else if (gap > 1)
+                    _metrics.framesSkipped.add(gap - 1);
+
+                double arrival = std::chrono::duration<double>(receivedAt - _lastArrival).count();
+                _metrics.frameJitter.observe(std::abs(arrival - (data->fTimestamp - _lastServerTime)));
+            }
+            _lastFrameNumber = data->iFrame;
+            _lastServerTime = data->fTimestamp;
+            _lastArrival = receivedAt;
+
+            // The frame is written in place into the ring, or into a jitter buffer slot where it waits
+            // for its playout time
+            JitterBuffer<MocapFrame>* buffer = _jitterBuffer.get();
+            MocapFrame* slot = buffer ? buffer->acquire() : claimSlot();
+            if (!slot)
+                return;
 
-                // Maintain a cap on the queue size, removing oldest as necessary
-                while ((int)_networkQueue.size() > kMaxQueueSize)
-                {
-                    f = _networkQueue.front();
-                    NatNet_FreeFrame(f.data.get());
-                    _networkQueue.pop_front();
-                }
-                _networkQueueMutex.unlock();
+            MocapFrame& f = *slot;
+            if (_reserveSlots.load(std::memory_order_relaxed)) {
+                f.template reserve<Traits::categories>();
+                _reserveSlots--;
             }
-            else
+
+            // Copy only the ingested categories (legacy servers may still send unsubscribed ones)
             {
-                // Unable to lock the frame queue and we chose not to wait - drop the frame and notify
-                NatNet_FreeFrame(pDataCopy.get());
-                printf("\nFrame dropped (Frame : %d)\n", f.data->iFrame);
+                OPTITRACK_TRACE_SCOPE("assign", data->iFrame);
+                f.template assign<Traits::categories>(*data, _ingest.load(std::memory_order_relaxed));
             }
+            f.clientLatencyMillisec = clientLatency;
+            f.transitLatencyMillisec = transitLatency;
+            f.receivedAt = receivedAt;
+            double exposure = updateClocks(data, f);
+
+            if (live) {
+                _metrics.clientLatency.observe(f.clientLatencyMillisec / 1000.0);
+                _metrics.transitLatency.observe(f.transitLatencyMillisec / 1000.0);
+            }
+
+            if (buffer)
+                buffer->push(slot, data->iFrame, exposure, receivedAt);
+            else
+                publishSlot();
         }
 
-        static void NATNET_CALLCONV dataHandler(sFrameOfMocapData* data, void* pUserData)
+        // Ring slot of the next frame; a lossless reader still holding it gets 5 ms to release it, as
+        // long as it keeps up. nullptr when the frame is dropped.
+        MocapFrame* claimSlot()
         {
-            // static_cast<Optitrack*>(pUserData)->update(data);
-            static_cast<Optitrack*>(pUserData)->storeFrames(data);
+            std::chrono::nanoseconds waited;
+            MocapFrame* slot = _ring.claim(std::chrono::milliseconds(5), waited);
+            if (waited.count())
+                _metrics.backpressure.observe(std::chrono::duration<double>(waited).count());
+            if (!slot)
+                _metrics.framesDropped.add();
+            return slot;
         }
 
-        // MessageHandler receives NatNet error/debug messages
-        static void NATNET_CALLCONV MessageHandler(Verbosity msgType, const char* msg)
+        void publishSlot()
         {
-            // Optional: Filter out debug messages
-            if (msgType < Verbosity_Info) {
+            _ring.publish();
+            _metrics.queueDepth.set(static_cast<double>(std::min<int64_t>(_tableReader.lag(), kQueueCapacity)));
+
+#ifdef OPTITRACK_COROUTINES
+            _frameAwaiters.notify();
+#endif
+        }
+
+        // Playout thread of the jitter buffer: the frame's buffers are swapped with those of the ring slot
+        void releaseFrame(MocapFrame& frame)
+        {
+            OPTITRACK_TRACE_SCOPE("playout", frame.iFrame);
+            MocapFrame* slot = claimSlot();
+            if (!slot)
                 return;
-            }
 
-            printf("\n[NatNetLib]");
+            std::swap(*slot, frame);
+            publishSlot();
+        }
 
-            switch (msgType) {
-            case Verbosity_Debug:
-                printf(" [DEBUG]");
-                break;
-            case Verbosity_Info:
-                printf("  [INFO]");
-                break;
-            case Verbosity_Warning:
-                printf("  [WARN]");
-                break;
-            case Verbosity_Error:
-                printf(" [ERROR]");
-                break;
-            default:
-                printf(" [?????]");
-                break;
+        // PrecisionTimestampFractionalSecs is taken as a 32 bit binary fraction of a second (PTP/NTP convention)
+        static double precisionSeconds(uint32_t seconds, uint32_t fractionalSeconds)
+        {
+            return seconds + fractionalSeconds / 4294967296.0;
+        }
+
+        // Returns the exposure time on the server clock, seconds
+        double updateClocks(sFrameOfMocapData* data, MocapFrame& f)
+        {
+            // NatNet's own estimate of the exposure in local time; jittery but unbiased
+            double exposure = toSeconds(f.receivedAt) - f.clientLatencyMillisec / 1000.0;
+
+            std::lock_guard<std::mutex> lock(_clockMutex);
+
+            // Pre NatNet 3.0 servers do not report their clock frequency, keep the raw estimate
+            if (_hostClockFrequency <= 0) {
+                f.exposureTime = toTimePoint(exposure);
+                return data->fTimestamp;
             }
 
-            printf(": %s\n", msg);
+            double hostSeconds = data->CameraMidExposureTimestamp / _hostClockFrequency;
+            _hostClock.update(hostSeconds, exposure);
+
+            ClockEstimate estimate = _hostClock.predict(hostSeconds);
+            f.exposureTime = toTimePoint(estimate.time);
+            f.exposureErrorBound = estimate.errorBound;
+
+            if (data->PrecisionTimestampSecs != 0)
+                _precisionClock.update(precisionSeconds(data->PrecisionTimestampSecs, data->PrecisionTimestampFractionalSecs), estimate.time);
+            return hostSeconds;
         }
 
-        void resetClient()
+        static void NATNET_CALLCONV dataHandler(sFrameOfMocapData* data, void* pUserData)
         {
-            int iSuccess;
+            // static_cast<Optitrack*>(pUserData)->update(data);
+            OPTITRACK_TRACE_THREAD("natnet");
+            BasicOptitrack* self = static_cast<BasicOptitrack*>(pUserData);
+            self->detectReceiveThread();
+            self->storeFrames(data);
+        }
 
-            printf("\n\nre-setting Client\n\n.");
+        // NatNet owns the receive thread and may replace it on reconnect; notice a new thread (one
+        // thread_local read per frame) and apply a pending real-time configuration from within it
+        void detectReceiveThread()
+        {
+            thread_local pid_t tid = realtime::threadId();
+            bool changed = _natnetTid.exchange(tid, std::memory_order_relaxed) != tid;
+            if (!changed && !_realTimePending.load(std::memory_order_relaxed))
+                return;
 
-            iSuccess = _client->Disconnect();
-            if (iSuccess != 0)
-                printf("error un-initting Client\n");
+            if (changed)
+                OPTITRACK_LOG_INFO("NatNet receive thread TID %d", static_cast<int>(tid));
 
-            iSuccess = _client->Connect(_connectParams);
-            if (iSuccess != 0)
-                printf("error re-initting Client\n");
+            _realTimePending = false;
+            std::lock_guard<std::mutex> lock(_realTimeMutex);
+            if (!_realTime.natnet.empty())
+                realtime::configureCurrentThread(_realTime.natnet);
         }
 
-        char getch()
+        // Reconnect with the last connection settings; handles stay valid since they are bound by name
+        bool resetClient()
         {
-            char buf = 0;
-            termios old = {0};
+            OPTITRACK_LOG_INFO("Re-setting client");
 
-            fflush(stdout);
+            // Called from the watchdog thread too: no command may be on the wire while the client is
+            // torn down and reconnected
+            auto paused = _commands->pause();
+            if (connectClient() != ErrorCode_OK) {
+                OPTITRACK_LOG_ERROR("Error re-initting client");
+                return false;
+            }
+            _metrics.reconnects.add();
 
-            if (tcgetattr(0, &old) < 0)
-                perror("tcsetattr()");
+            return updateDataDescriptions();
+        }
 
-            old.c_lflag &= ~ICANON;
-            old.c_lflag &= ~ECHO;
-            old.c_cc[VMIN] = 1;
-            old.c_cc[VTIME] = 0;
+        // Jitter buffer depth, delay and drop counters in the Prometheus text format
+        void collectJitterBuffer(std::string& out)
+        {
+            JitterBufferStats stats = _jitterBuffer->stats();
+            MetricsRegistry::family(out, "optitrack_jitter_buffer_depth", "Frames waiting in the jitter buffer for their playout time", "gauge");
+            MetricsRegistry::sample(out, "optitrack_jitter_buffer_depth", "", static_cast<double>(stats.depth));
+            MetricsRegistry::family(out, "optitrack_jitter_buffer_delay_seconds", "Playout delay beyond the fastest transit", "gauge");
+            MetricsRegistry::sample(out, "optitrack_jitter_buffer_delay_seconds", "", stats.delay);
+            MetricsRegistry::family(out, "optitrack_jitter_buffer_late_total", "Frames that arrived after their playout time", "counter");
+            MetricsRegistry::sample(out, "optitrack_jitter_buffer_late_total", "", stats.late);
+            MetricsRegistry::family(out, "optitrack_jitter_buffer_reordered_total", "Frames that arrived after a newer one and were put back in order", "counter");
+            MetricsRegistry::sample(out, "optitrack_jitter_buffer_reordered_total", "", stats.reordered);
+            MetricsRegistry::family(out, "optitrack_jitter_buffer_discarded_total", "Frames too late to reorder, duplicated or beyond the buffer capacity", "counter");
+            MetricsRegistry::sample(out, "optitrack_jitter_buffer_discarded_total", "", stats.discarded);
+        }
 
-            if (tcsetattr(0, TCSANOW, &old) < 0)
-                perror("tcsetattr ICANON");
+        // Per-body tracking counters in the Prometheus text format
+        void collectBodies(std::string& out)
+        {
+            std::lock_guard<std::mutex> lock(_tableMutex);
 
-            if (read(0, &buf, 1) < 0)
-                perror("read()");
+            MetricsRegistry::family(out, "optitrack_body_frames_total", "Frames in which the body was streamed", "counter");
+            for (size_t h = 0; h < _names.size(); h++)
+                MetricsRegistry::sample(out, "optitrack_body_frames_total", "body=\"" + metrics::escape(_names[h]) + "\"", _bodyFrames[h]);
 
-            old.c_lflag |= ICANON;
-            old.c_lflag |= ECHO;
+            MetricsRegistry::family(out, "optitrack_body_tracking_loss_ratio", "Fraction of the streamed frames in which the body was not tracked", "gauge");
+            for (size_t h = 0; h < _names.size(); h++)
+                MetricsRegistry::sample(out, "optitrack_body_tracking_loss_ratio", "body=\"" + metrics::escape(_names[h]) + "\"", _bodyFrames[h] ? double(_bodyLost[h]) / _bodyFrames[h] : 0.0);
 
-            if (tcsetattr(0, TCSADRAIN, &old) < 0)
-                perror("tcsetattr ~ICANON");
+            if constexpr (Traits::gate) {
+                MetricsRegistry::family(out, "optitrack_body_outliers_total", "Tracked samples rejected by the gate", "counter");
+                for (size_t h = 0; h < _names.size(); h++)
+                    MetricsRegistry::sample(out, "optitrack_body_outliers_total", "body=\"" + metrics::escape(_names[h]) + "\"", h < size_t(_gate.status().size()) ? _gate.stats(h).outliers : uint64_t(0));
+            }
+        }
 
-            // printf( "%c\n", buf );
+        int handleUnlocked(const std::string& bodyName)
+        {
+            auto it = _handles.find(bodyName);
+            if (it != _handles.end())
+                return it->second;
+
+            // Growing past the reserved capacity would move the table under live poses() views
+            if (_poses.size() >= MAX_RIGIDBODIES) {
+                OPTITRACK_LOG_ERROR("Pose table full (%d bodies), %s is not tracked", MAX_RIGIDBODIES, bodyName.c_str());
+                return -1;
+            }
 
-            return buf;
+            int handle = static_cast<int>(_poses.size());
+            _handles.emplace(bodyName, handle);
+            _names.push_back(bodyName);
+            _poses.push_back((Pose() << 0, 0, 0, 0, 0, 0, 1).finished());
+            _updated.push_back(std::chrono::steady_clock::time_point());
+            _exposure.push_back(std::chrono::steady_clock::time_point());
+            _exposureError.push_back(0);
+            _bodyFrames.push_back(0);
+            _bodyLost.push_back(0);
+
+            return handle;
         }
 
-        void updateDataToDescriptionMaps(sDataDescriptions* descriptionFrame)
+        // Cached descriptions of the server just connected, unless the current ones already are
+        void warmStart(uint64_t key)
         {
-            _assetIDtoAssetDescriptionOrder.clear();
-            _assetIDtoAssetName.clear();
-            int assetID = 0, index = 0, cameraIndex = 0;
-            std::string assetName = "";
-
-            if (descriptionFrame == nullptr || descriptionFrame->nDataDescriptions <= 0)
+            std::lock_guard<std::mutex> lock(_descriptionMutex);
+            _serverKey = key;
+            if (_descriptionCachePath.empty() || (_descriptions && _descriptions->serverKey() == key))
                 return;
 
-            for (int i = 0; i < descriptionFrame->nDataDescriptions; i++)
-            {
-                assetID = -1;
-                assetName = "";
-
-                if (descriptionFrame->arrDataDescriptions[i].type == Descriptor_RigidBody)
-                {
-                    sRigidBodyDescription* pRB = descriptionFrame->arrDataDescriptions[i].Data.RigidBodyDescription;
-                    assetID = pRB->ID;
-                    assetName = std::string(pRB->szName);
-                }
-                else if (descriptionFrame->arrDataDescriptions[i].type == Descriptor_Skeleton)
-                {
-                    sSkeletonDescription* pSK = descriptionFrame->arrDataDescriptions[i].Data.SkeletonDescription;
-                    assetID = pSK->skeletonID;
-                    assetName = std::string(pSK->szName);
-                }
-                else if (descriptionFrame->arrDataDescriptions[i].type == Descriptor_MarkerSet)
-                {
-                    // Skip markersets for now as they dont have unique id's, but do increase the index
-                    // as they are in the data packet
-                    index++;
-                    continue;
-                }
-                else if (descriptionFrame->arrDataDescriptions[i].type == Descriptor_ForcePlate)
-                {
-                    sForcePlateDescription* pDesc = descriptionFrame->arrDataDescriptions[i].Data.ForcePlateDescription;
-                    assetID = pDesc->ID;
-                    assetName = pDesc->strSerialNo;
-                }
-                else if (descriptionFrame->arrDataDescriptions[i].type == Descriptor_Device)
-                {
-                    sDeviceDescription* pDesc = descriptionFrame->arrDataDescriptions[i].Data.DeviceDescription;
-                    assetID = pDesc->ID;
-                    assetName = std::string(pDesc->strName);
-                }
-                else if (descriptionFrame->arrDataDescriptions[i].type == Descriptor_Camera)
-                {
-                    // skip cameras as they are not in the data packet
-                    continue;
-                }
-                else if (descriptionFrame->arrDataDescriptions[i].type == Descriptor_Asset)
-                {
-                    sAssetDescription* pDesc = descriptionFrame->arrDataDescriptions[i].Data.AssetDescription;
-                    assetID = pDesc->AssetID;
-                    assetName = std::string(pDesc->szName);
-                }
+            if (std::shared_ptr<const DescriptionCache> cached = DescriptionCache::open(_descriptionCachePath, key)) {
+                OPTITRACK_LOG_INFO("Using %zu cached descriptions from %s", cached->size(), _descriptionCachePath.c_str());
+                applyDescriptions(cached);
+            }
+        }
 
-                // Add to Asset ID to Asset Name map
-                if (assetID == -1)
-                    printf("\n[SampleClient] Warning : Unknown data type in description list : %d\n", descriptionFrame->arrDataDescriptions[i].type);
-                else 
-                {
-                    std::pair<std::map<int, std::string>::iterator, bool> insertResult;
-                    insertResult = _assetIDtoAssetName.insert(std::pair<int,std::string>(assetID, assetName));
-                    if (insertResult.second == false)
-                        printf("\n[SampleClient] Warning : Duplicate asset ID already in Name map (Existing:%d,%s\tNew:%d,%s\n)",
-                            insertResult.first->first, insertResult.first->second.c_str(), assetID, assetName.c_str());
+        // Call with _descriptionMutex held
+        void applyDescriptions(std::shared_ptr<const DescriptionCache> descriptions)
+        {
+            _descriptions = std::move(descriptions);
+            _metrics.descriptionRefreshes.add();
+            OPTITRACK_TRACE_SCOPE("applyDescriptions");
+
+            std::unordered_map<int, int> streamingIDtoHandle;
+            if constexpr (Traits::ingests(RigidBodies))
+                for (size_t i = 0; i < _descriptions->size(); i++) {
+                    const DescriptionCache::Asset& asset = _descriptions->asset(i);
+                    if (asset.type != Descriptor_RigidBody)
+                        continue;
+
+                    std::string name = _descriptions->name(i);
+                    if (!_subscription.subscribed(name))
+                        continue;
+                    int h = handle(name);
+                    if (h < 0)
+                        continue;
+                    if (!streamingIDtoHandle.emplace(asset.id, h).second)
+                        OPTITRACK_LOG_WARN("Duplicate rigid body ID %d (%s)", asset.id, name.c_str());
                 }
 
-                // Add to Asset ID to Asset Description Order map
-                if (assetID != -1)
-                {
-                    std::pair<std::map<int, int>::iterator, bool> insertResult;
-                    insertResult = _assetIDtoAssetDescriptionOrder.insert(std::pair<int, int>(assetID, index++));
-                    if (insertResult.second == false)
-                        printf("\n[SampleClient] Warning : Duplicate asset ID already in Order map (ID:%d\tOrder:%d\n)", insertResult.first->first, insertResult.first->second);
-                }
-            }
+            std::lock_guard<std::mutex> lock(_tableMutex);
+            _streamingIDtoHandle.swap(streamingIDtoHandle);
         }
 
-        sDataDescriptions* _descriptionFrame;
-        std::map<int, int> _assetIDtoAssetDescriptionOrder;
-        std::map<int, std::string> _assetIDtoAssetName;
-        bool _updatedDataDescriptions = false, _needUpdatedDataDescriptions = true;
+        // Descriptions in use, shared with descriptions() callers (guarded by _descriptionMutex)
+        std::mutex _descriptionMutex;
+        std::shared_ptr<const DescriptionCache> _descriptions;
+        std::string _descriptionCachePath;
+        uint64_t _serverKey = 0;
 
         
-        std::timed_mutex _networkQueueMutex;
-        std::deque<MocapFrameWrapper> _networkQueue;
-        const int kMaxQueueSize = 1;
+        // Optional playout stage between the receive thread and the ring
+        std::unique_ptr<JitterBuffer<MocapFrame>> _jitterBuffer;
+
+#ifdef OPTITRACK_COROUTINES
+        // Call with _tableMutex held
+        bool resolvePose(int handle, std::chrono::steady_clock::time_point time, StampedPose& result)
+        {
+            if (_exposure[handle] == std::chrono::steady_clock::time_point() || _exposure[handle] < time)
+                return false;
+            result.pose = _poses[handle];
+            result.exposure = _exposure[handle];
+            return true;
+        }
+
+        struct PoseAwaiter {
+            int handle;
+            std::chrono::steady_clock::time_point time;
+            std::coroutine_handle<> coroutine;
+            StampedPose* result;
+        };
+
+        Executor _executor = resumeInline;
+        detail::AwaitList _frameAwaiters;
+        std::vector<PoseAwaiter> _poseAwaiters; // guarded by _tableMutex
+#endif
+
+        // Frames from the NatNet thread to updateData() and the readers; slots are written in place and
+        // keep their buffers. Declared last so that readers are released before it.
+        static constexpr size_t kQueueCapacity = Traits::queueCapacity;
+        FrameRing _ring;
+        FrameReader _tableReader;
+        std::vector<std::chrono::steady_clock::time_point> _arrivals;
+        std::atomic<size_t> _reserveSlots{0};
 
         // std::timed_mutex _networkQueueMutex;
         // std::deque<MocapFrameWrapper> _networkQueue;
@@ -537,6 +1624,12 @@ namespace optitrack_lib {
         // bool gNeedUpdatedDataDescriptions = true;
     };
 
+    // Every category, double precision poses, validity gate and optional filter
+    using Optitrack = BasicOptitrack<>;
+
+    // Rigid bodies only, single precision poses, tracked samples straight into the table
+    using RigidBodyOptitrack = BasicOptitrack<Ingest<RigidBodies>, Precision<float>, NoFilter>;
+
 } // namespace optitrack_lib
 
 #endif // OPTITRACKLIB_OPTITRACK_HPP
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef OPTITRACKLIB_POLICIES_HPP
+#define OPTITRACKLIB_POLICIES_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace optitrack_lib {
+    // Data categories of a NatNet frame
+    enum Category : uint32_t {
+        RigidBodies = 1 << 0,
+        MarkerSets = 1 << 1,
+        LabeledMarkers = 1 << 2,
+        UnlabeledMarkers = 1 << 3,
+        Skeletons = 1 << 4,
+        ForcePlates = 1 << 5,
+        Devices = 1 << 6,
+
+        Markers = MarkerSets | LabeledMarkers | UnlabeledMarkers,
+        AllCategories = (1 << 7) - 1
+    };
+
+    // Pipeline policies of BasicOptitrack; each one may be given in any order, missing ones take the default
+
+    // Categories copied out of the NatNet frame, e.g. Ingest<RigidBodies | LabeledMarkers>
+    struct IngestPolicy {
+    };
+
+    template <uint32_t Categories>
+    struct Ingest {
+        using kind = IngestPolicy;
+        static constexpr uint32_t categories = Categories;
+    };
+
+    // Scalar type of the pose table
+    struct PrecisionPolicy {
+    };
+
+    template <typename T>
+    struct Precision {
+        using kind = PrecisionPolicy;
+        using Scalar = T;
+    };
+
+    // Frames buffered between the NatNet thread and updateData(); the oldest ones are dropped
+    struct QueuePolicy {
+    };
+
+    template <size_t Capacity>
+    struct FrameQueue {
+        static_assert(Capacity > 0, "FrameQueue needs room for at least one frame");
+        using kind = QueuePolicy;
+        static constexpr size_t capacity = Capacity;
+    };
+
+    using LatestFrame = FrameQueue<1>;
+
+    // Stages between the frame and the pose table
+    struct FilterPolicy {
+    };
+
+    struct NoFilter { // tracked samples go straight into the table
+        using kind = FilterPolicy;
+        static constexpr bool gate = false, filter = false;
+    };
+
+    struct GateOnly { // validity gate, see Gating.hpp
+        using kind = FilterPolicy;
+        static constexpr bool gate = true, filter = false;
+    };
+
+    struct GateAndFilter { // validity gate and a filter bank selected at runtime with enableFilter()
+        using kind = FilterPolicy;
+        static constexpr bool gate = true, filter = true;
+    };
+
+    namespace detail {
+        // Placeholder member of a compiled-out stage
+        struct Disabled {
+        };
+
+        template <typename Kind, typename Default, typename... Policies>
+        struct SelectPolicy {
+            using type = Default;
+        };
+
+        template <typename Kind, typename Default, typename Policy, typename... Policies>
+        struct SelectPolicy<Kind, Default, Policy, Policies...> {
+            using type = std::conditional_t<std::is_same<typename Policy::kind, Kind>::value, Policy, typename SelectPolicy<Kind, Default, Policies...>::type>;
+        };
+    } // namespace detail
+
+    template <typename... Policies>
+    struct PipelineTraits {
+        using IngestType = typename detail::SelectPolicy<IngestPolicy, Ingest<AllCategories>, Policies...>::type;
+        using PrecisionType = typename detail::SelectPolicy<PrecisionPolicy, Precision<double>, Policies...>::type;
+        using QueueType = typename detail::SelectPolicy<QueuePolicy, LatestFrame, Policies...>::type;
+        using FilterStage = typename detail::SelectPolicy<FilterPolicy, GateAndFilter, Policies...>::type;
+
+        static constexpr uint32_t categories = IngestType::categories;
+        using Scalar = typename PrecisionType::Scalar;
+        static constexpr size_t queueCapacity = QueueType::capacity;
+        static constexpr bool gate = FilterStage::gate, filter = FilterStage::filter;
+
+        static constexpr bool ingests(uint32_t category) { return (categories & category) != 0; }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_POLICIES_HPP
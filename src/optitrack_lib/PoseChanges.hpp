@@ -0,0 +1,231 @@
+#ifndef OPTITRACKLIB_POSECHANGES_HPP
+#define OPTITRACKLIB_POSECHANGES_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace optitrack_lib {
+    // Deadband test of all pose listeners in one branch-free pass over structure-of-arrays data. A
+    // listener fires when its body moved further than its deadbands from the pose it was last notified
+    // with, so slow drifts are reported too.
+    class ChangeBank {
+    public:
+        using Array = Eigen::Array<float, Eigen::Dynamic, 1>;
+        using Mask = Eigen::Array<bool, Eigen::Dynamic, 1>;
+        using Poses = Eigen::Array<float, Eigen::Dynamic, 7>;
+        using Indices = Eigen::Array<Eigen::Index, Eigen::Dynamic, 1>;
+
+        size_t size() const { return _handles.rows(); }
+
+        bool empty() const { return !_handles.rows(); }
+
+        // translation: m, rotation: rad; returns the listener index
+        int add(int handle, float translation, float rotation)
+        {
+            Eigen::Index n = _handles.rows();
+            _handles.conservativeResize(n + 1);
+            _translation2.conservativeResize(n + 1);
+            _rotationDot.conservativeResize(n + 1);
+            _notified.conservativeResize(n + 1, 7);
+            _initialized.conservativeResize(n + 1);
+            _active.conservativeResize(n + 1);
+
+            _handles(n) = handle;
+            _translation2(n) = translation * translation;
+            // angle(q1, q2) = 2 acos(|q1.q2|), compared through the dot product
+            _rotationDot(n) = std::cos(std::min(rotation, 3.14159265f) / 2);
+            _notified.row(n).setZero();
+            _initialized(n) = false;
+            _active(n) = true;
+
+            return static_cast<int>(n);
+        }
+
+        // Indices are never reused, the listener just stops firing
+        void remove(int listener)
+        {
+            if (listener >= 0 && listener < _active.rows())
+                _active(listener) = false;
+        }
+
+        // poses: N x 7 table of the frame (x y z qx qy qz qw); updated: bodies with a new sample in it.
+        // Returns the listeners that fire, their notified pose becomes the current one.
+        const std::vector<int>& update(const Poses& poses, const Mask& updated)
+        {
+            _fired.clear();
+            Eigen::Index n = _handles.rows();
+            if (!n)
+                return _fired;
+
+            // Listeners of bodies the frame does not cover yet cannot fire; buffers are kept across frames
+            _rows = (_handles < poses.rows()).select(_handles, Indices::Zero(n));
+            _current = poses(_rows, Eigen::all);
+
+            _distance2 = (_current.leftCols<3>() - _notified.leftCols<3>()).square().rowwise().sum();
+            _dot = (_current.rightCols<4>() * _notified.rightCols<4>()).rowwise().sum().abs();
+            _fire = updated(_rows);
+            _fire = _fire && _handles < poses.rows() && _active && (!_initialized || _distance2 > _translation2 || _dot < _rotationDot);
+
+            // Few listeners fire in a typical frame, their rows are updated one by one
+            for (Eigen::Index i = 0; i < n; i++)
+                if (_fire(i)) {
+                    _notified.row(i) = _current.row(i);
+                    _initialized(i) = true;
+                    _fired.push_back(static_cast<int>(i));
+                }
+
+            return _fired;
+        }
+
+        int handle(int listener) const { return static_cast<int>(_handles(listener)); }
+
+    protected:
+        Indices _handles;
+        Array _translation2, _rotationDot;
+        Poses _notified;
+        Mask _initialized, _active;
+
+        Indices _rows;
+        Poses _current;
+        Array _distance2, _dot;
+        Mask _fire;
+        std::vector<int> _fired;
+    };
+
+    // Bounded pool of worker threads running pose callbacks. Each listener has one pending slot: a
+    // change posted while the previous one is still queued or running replaces it, so a slow callback
+    // always sees the latest pose and never a backlog. A listener's callback never runs concurrently
+    // with itself, and the queue never holds more entries than there are listeners.
+    template <typename Pose>
+    class PoseDispatcher {
+    public:
+        using Callback = std::function<void(int handle, const Pose& pose, std::chrono::steady_clock::time_point exposure)>;
+
+        PoseDispatcher(size_t threads = 2)
+        {
+            for (size_t i = 0; i < std::max<size_t>(threads, 1); i++)
+                _threads.emplace_back(&PoseDispatcher::run, this);
+        }
+
+        ~PoseDispatcher()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _condition.notify_all();
+            for (std::thread& thread : _threads)
+                thread.join();
+        }
+
+        // Ids follow the ChangeBank listener indices
+        int add(int handle, Callback callback)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _slots.push_back(std::make_unique<Slot>());
+            _slots.back()->handle = handle;
+            _slots.back()->callback = std::move(callback);
+            return static_cast<int>(_slots.size() - 1);
+        }
+
+        // A callback already running completes, no further call starts
+        void remove(int id)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (id < 0 || static_cast<size_t>(id) >= _slots.size())
+                return;
+
+            _slots[id]->active = false;
+            _slots[id]->pending = false;
+        }
+
+        // Returns false when the change replaced one that had not been delivered yet
+        bool post(int id, const Pose& pose, std::chrono::steady_clock::time_point exposure)
+        {
+            bool fresh, wake = false;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                Slot& slot = *_slots[id];
+                if (!slot.active)
+                    return true;
+
+                fresh = !slot.pending;
+                slot.pose = pose;
+                slot.exposure = exposure;
+                slot.pending = true;
+
+                // A running slot is requeued by its worker
+                if (!slot.queued && !slot.running) {
+                    slot.queued = true;
+                    _queue.push_back(&slot);
+                    wake = true;
+                }
+            }
+            if (wake)
+                _condition.notify_one();
+            return fresh;
+        }
+
+        std::vector<std::thread>& threads() { return _threads; }
+
+    protected:
+        struct Slot {
+            int handle;
+            Callback callback;
+            Pose pose;
+            std::chrono::steady_clock::time_point exposure;
+            bool active = true, pending = false, queued = false, running = false;
+        };
+
+        std::vector<std::thread> _threads;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::vector<std::unique_ptr<Slot>> _slots;
+        std::deque<Slot*> _queue;
+        bool _stop = false;
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true) {
+                _condition.wait(lock, [this]() { return _stop || !_queue.empty(); });
+                if (_stop)
+                    return;
+
+                Slot& slot = *_queue.front();
+                _queue.pop_front();
+                slot.queued = false;
+                if (!slot.pending)
+                    continue;
+
+                Pose pose = slot.pose;
+                auto exposure = slot.exposure;
+                slot.pending = false;
+                slot.running = true;
+
+                lock.unlock();
+                slot.callback(slot.handle, pose, exposure);
+                lock.lock();
+
+                // Changes that arrived meanwhile go to the back, so one busy body cannot starve the others
+                slot.running = false;
+                if (slot.pending) {
+                    slot.queued = true;
+                    _queue.push_back(&slot);
+                }
+            }
+        }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_POSECHANGES_HPP
@@ -0,0 +1,356 @@
+#ifndef OPTITRACKLIB_POSECODEC_HPP
+#define OPTITRACKLIB_POSECODEC_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace optitrack_lib {
+    // Compact pose packets for low-bandwidth links (layout mirrored by src/python/pose_codec.py).
+    //
+    // Positions are quantized to a fixed resolution and quaternions to smallest-three (index of the
+    // largest component plus the other three). Keyframes carry these integers, delta frames their
+    // difference to the last keyframe. Every channel is bit-packed with the smallest width that fits
+    // all bodies of the packet, so still bodies cost a few bits. Keyframes are sent periodically and a
+    // decoder that lost one skips deltas until the next.
+    //
+    // Packet (little endian):
+    //   u8 version, u8 flags (bit 0 keyframe), u16 sequence, u16 keyframe sequence, u16 bodies,
+    //   u32 packet bytes, f32 resolution (m), u8 widths[6],
+    //   bit stream (LSB first): 2-bit index per body, then channels x, y, z, a, b, c of zigzag integers
+    struct CodecParams {
+        float resolution = 1e-4f; // m
+        uint32_t keyframeInterval = 60; // packets
+    };
+
+    namespace codec {
+        constexpr uint8_t kVersion = 1;
+        constexpr uint8_t kKeyframe = 0x01;
+        constexpr size_t kHeaderSize = 22;
+        constexpr int kChannels = 6;
+
+        // Smallest-three components lie in [-1/sqrt(2), 1/sqrt(2)]
+        constexpr double kQuaternionScale = 32767.0 * 1.4142135623730951;
+
+        using Integers = Eigen::Array<int64_t, Eigen::Dynamic, kChannels>;
+        using Indices = Eigen::Array<uint8_t, Eigen::Dynamic, 1>;
+
+        inline uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+
+        inline int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+        inline int width(uint64_t value)
+        {
+            int bits = 0;
+            while (value >> bits)
+                bits++;
+            return bits;
+        }
+
+        // Appends to the buffer a 64-bit word at a time
+        class BitWriter {
+        public:
+            BitWriter(std::vector<uint8_t>& buffer) : _buffer(buffer) {}
+
+            void write(uint64_t value, int bits)
+            {
+                if (bits == 0)
+                    return;
+
+                _accumulator |= value << _filled;
+                if (_filled + bits >= 64) {
+                    flush64();
+                    _accumulator = _filled ? value >> (64 - _filled) : 0;
+                    _filled = _filled + bits - 64;
+                }
+                else
+                    _filled += bits;
+            }
+
+            void finish()
+            {
+                for (; _filled > 0; _filled -= 8) {
+                    _buffer.push_back(static_cast<uint8_t>(_accumulator));
+                    _accumulator >>= 8;
+                }
+                _filled = 0;
+            }
+
+        protected:
+            std::vector<uint8_t>& _buffer;
+            uint64_t _accumulator = 0;
+            int _filled = 0;
+
+            void flush64()
+            {
+                size_t end = _buffer.size();
+                _buffer.resize(end + 8);
+                std::memcpy(&_buffer[end], &_accumulator, 8);
+            }
+        };
+
+        class BitReader {
+        public:
+            BitReader(const uint8_t* data, size_t size) : _data(data), _size(size) {}
+
+            // Reads past the end, or of more than 64 bits, return zeros; check overrun() afterwards
+            uint64_t read(int bits)
+            {
+                if (bits < 0 || bits > 64) {
+                    _position = 8 * _size + 1;
+                    return 0;
+                }
+
+                // Fast path: one unaligned 64-bit load covers up to 57 bits
+                size_t first = _position >> 3;
+                int offset = _position & 7;
+                if (bits <= 57 && first + 8 <= _size) {
+                    uint64_t word;
+                    std::memcpy(&word, _data + first, 8);
+                    _position += bits;
+                    return bits ? (word >> offset) & (~uint64_t(0) >> (64 - bits)) : 0;
+                }
+
+                uint64_t value = 0;
+                for (int done = 0; done < bits;) {
+                    size_t byte = _position >> 3;
+                    int offset = _position & 7, take = std::min(bits - done, 8 - offset);
+                    uint64_t chunk = byte < _size ? (_data[byte] >> offset) & ((1u << take) - 1) : 0;
+                    value |= chunk << done;
+                    done += take;
+                    _position += take;
+                }
+                return value;
+            }
+
+            bool overrun() const { return _position > 8 * _size; }
+
+        protected:
+            const uint8_t* _data;
+            size_t _size;
+            size_t _position = 0;
+        };
+    } // namespace codec
+
+    class PoseEncoder {
+    public:
+        PoseEncoder(const CodecParams& params = CodecParams()) : _params(params) {}
+
+        void forceKeyframe() { _forceKeyframe = true; }
+
+        // Worst case packet size, e.g. to size transport buffers
+        static size_t maxPacketSize(size_t bodies) { return codec::kHeaderSize + (bodies * (2 + codec::kChannels * 64) + 7) / 8; }
+
+        // poses: one row per body (x, y, z, qx, qy, qz, qw), any dense Eigen expression
+        template <typename Derived>
+        const std::vector<uint8_t>& encode(const Eigen::DenseBase<Derived>& poses)
+        {
+            quantize(poses);
+
+            Eigen::Index n = _integers.rows();
+            bool keyframe = _forceKeyframe || _keyframe.rows() != n || _sinceKeyframe + 1 >= _params.keyframeInterval;
+
+            if (!keyframe)
+                _values = _integers - _keyframe;
+            else {
+                _keyframe = _integers;
+                _keyframeSequence = _sequence;
+                _values = _integers;
+            }
+
+            _packet.clear();
+            _packet.resize(codec::kHeaderSize);
+
+            uint8_t widths[codec::kChannels];
+            for (int c = 0; c < codec::kChannels; c++) {
+                uint64_t bits = 0;
+                for (Eigen::Index i = 0; i < n; i++)
+                    bits |= codec::zigzag(_values(i, c));
+                widths[c] = static_cast<uint8_t>(codec::width(bits));
+            }
+
+            codec::BitWriter writer(_packet);
+            for (Eigen::Index i = 0; i < n; i++)
+                writer.write(_indices(i), 2);
+            for (int c = 0; c < codec::kChannels; c++)
+                for (Eigen::Index i = 0; i < n; i++)
+                    writer.write(codec::zigzag(_values(i, c)), widths[c]);
+            writer.finish();
+
+            uint8_t version = codec::kVersion, flags = keyframe ? codec::kKeyframe : 0;
+            uint16_t bodies = static_cast<uint16_t>(n);
+            uint32_t bytes = static_cast<uint32_t>(_packet.size());
+            std::memcpy(&_packet[0], &version, 1);
+            std::memcpy(&_packet[1], &flags, 1);
+            std::memcpy(&_packet[2], &_sequence, 2);
+            std::memcpy(&_packet[4], &_keyframeSequence, 2);
+            std::memcpy(&_packet[6], &bodies, 2);
+            std::memcpy(&_packet[8], &bytes, 4);
+            std::memcpy(&_packet[12], &_params.resolution, 4);
+            std::memcpy(&_packet[16], widths, codec::kChannels);
+
+            _sinceKeyframe = keyframe ? 0 : _sinceKeyframe + 1;
+            _forceKeyframe = false;
+            _sequence++;
+
+            return _packet;
+        }
+
+    protected:
+        CodecParams _params;
+        uint16_t _sequence = 0, _keyframeSequence = 0;
+        uint32_t _sinceKeyframe = 0;
+        bool _forceKeyframe = true;
+
+        codec::Integers _integers, _keyframe, _values;
+        codec::Indices _indices;
+        std::vector<uint8_t> _packet;
+
+        template <typename Derived>
+        void quantize(const Eigen::DenseBase<Derived>& poses)
+        {
+            using Array = Eigen::Array<double, Eigen::Dynamic, 1>;
+            Eigen::Index n = poses.rows();
+
+            _integers.resize(n, codec::kChannels);
+            for (int c = 0; c < 3; c++)
+                _integers.col(c) = (poses.col(c).template cast<double>().array() / _params.resolution).round().template cast<int64_t>();
+
+            // Largest absolute component, with branch-free column selects
+            Array q[4];
+            for (int k = 0; k < 4; k++)
+                q[k] = poses.col(3 + k).template cast<double>().array();
+
+            Eigen::Array<int, Eigen::Dynamic, 1> index = Eigen::Array<int, Eigen::Dynamic, 1>::Zero(n);
+            Array largest = q[0].abs(), sign = q[0];
+            for (int k = 1; k < 4; k++) {
+                auto greater = q[k].abs() > largest;
+                index = greater.select(k, index);
+                sign = greater.select(q[k], sign);
+                largest = largest.max(q[k].abs());
+            }
+            sign = (sign < 0).select(Array::Constant(n, -1.0), Array::Constant(n, 1.0));
+
+            // The three remaining components in order (slot j holds component j below the dropped index,
+            // component j + 1 from it on), flipped so that the dropped one is positive
+            for (int j = 0; j < 3; j++) {
+                Array component = (index > j).select(q[j], q[j + 1]);
+                _integers.col(3 + j) = (component * sign * codec::kQuaternionScale).round().template cast<int64_t>();
+            }
+
+            _indices = index.cast<uint8_t>();
+        }
+    };
+
+    class PoseDecoder {
+    public:
+        using Poses = Eigen::Array<double, Eigen::Dynamic, 7>;
+
+        // False if the packet is malformed or refers to a keyframe this decoder has not seen
+        bool decode(const uint8_t* data, size_t size)
+        {
+            if (size < codec::kHeaderSize || data[0] != codec::kVersion)
+                return false;
+
+            uint8_t flags = data[1];
+            uint16_t sequence, keyframeSequence, bodies;
+            uint32_t bytes;
+            float resolution;
+            uint8_t widths[codec::kChannels];
+            std::memcpy(&sequence, data + 2, 2);
+            std::memcpy(&keyframeSequence, data + 4, 2);
+            std::memcpy(&bodies, data + 6, 2);
+            std::memcpy(&bytes, data + 8, 4);
+            std::memcpy(&resolution, data + 12, 4);
+            std::memcpy(widths, data + 16, codec::kChannels);
+
+            // Transports may hand over a larger buffer than the packet
+            if (bytes > size || bytes < codec::kHeaderSize)
+                return false;
+
+            // Every channel fits 64 bits, and the bit stream has to fit the rest of the packet
+            uint64_t bitsPerBody = 2;
+            for (int c = 0; c < codec::kChannels; c++) {
+                if (widths[c] > 64)
+                    return false;
+                bitsPerBody += widths[c];
+            }
+            if (bitsPerBody * bodies > 8 * uint64_t(bytes - codec::kHeaderSize))
+                return false;
+
+            bool keyframe = flags & codec::kKeyframe;
+            if (!keyframe && (!_haveKeyframe || keyframeSequence != _keyframeSequence || _keyframe.rows() != bodies))
+                return false;
+
+            Eigen::Index n = bodies;
+            codec::BitReader reader(data + codec::kHeaderSize, bytes - codec::kHeaderSize);
+
+            _indices.resize(n);
+            for (Eigen::Index i = 0; i < n; i++)
+                _indices(i) = static_cast<uint8_t>(reader.read(2));
+
+            _integers.resize(n, codec::kChannels);
+            for (int c = 0; c < codec::kChannels; c++)
+                for (Eigen::Index i = 0; i < n; i++)
+                    _integers(i, c) = codec::unzigzag(reader.read(widths[c]));
+
+            if (reader.overrun())
+                return false;
+
+            if (keyframe) {
+                _keyframe = _integers;
+                _keyframeSequence = sequence;
+                _haveKeyframe = true;
+            }
+            else
+                _integers += _keyframe;
+
+            dequantize(resolution);
+            _sequence = sequence;
+
+            return true;
+        }
+
+        bool decode(const std::vector<uint8_t>& packet) { return decode(packet.data(), packet.size()); }
+
+        const Poses& poses() const { return _poses; }
+
+        uint16_t sequence() const { return _sequence; }
+
+    protected:
+        bool _haveKeyframe = false;
+        uint16_t _sequence = 0, _keyframeSequence = 0;
+        codec::Integers _integers, _keyframe;
+        codec::Indices _indices;
+        Poses _poses;
+
+        void dequantize(double resolution)
+        {
+            using Array = Eigen::Array<double, Eigen::Dynamic, 1>;
+            Eigen::Index n = _integers.rows();
+
+            _poses.resize(n, 7);
+            _poses.leftCols<3>() = _integers.leftCols<3>().cast<double>() * resolution;
+
+            Eigen::Array<double, Eigen::Dynamic, 3> small = _integers.rightCols<3>().cast<double>() / codec::kQuaternionScale;
+            Array largest = (1.0 - small.square().rowwise().sum()).max(0.0).sqrt();
+
+            // Scatter back: component k is the dropped one, or slot k (k < index) or slot k - 1 (k > index)
+            Eigen::Array<int, Eigen::Dynamic, 1> index = _indices.cast<int>();
+            for (int k = 0; k < 4; k++) {
+                Array value = largest;
+                if (k < 3)
+                    value = (index > k).select(small.col(k), value);
+                if (k > 0)
+                    value = (index < k).select(small.col(k - 1), value);
+                _poses.col(3 + k) = value;
+            }
+        }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_POSECODEC_HPP
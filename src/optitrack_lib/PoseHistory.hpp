@@ -0,0 +1,102 @@
+#ifndef OPTITRACKLIB_POSEHISTORY_HPP
+#define OPTITRACKLIB_POSEHISTORY_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace optitrack_lib {
+    // One accepted sample; plain layout so that it maps directly onto a NumPy structured dtype
+    struct PoseSample {
+        double time; // exposure time, steady_clock seconds
+        double pose[7]; // x, y, z, qx, qy, qz, qw
+    };
+
+    // Fixed-capacity ring of recent samples per body, in one contiguous allocation.
+    // Samples are pushed in time order, so window queries are binary searches.
+    class PoseHistory {
+    public:
+        PoseHistory(size_t capacity = 1024) : _capacity(std::max<size_t>(capacity, 1)) {}
+
+        size_t capacity() const { return _capacity; }
+
+        size_t bodies() const { return _count.size(); }
+
+        size_t size(int handle) const { return handle < static_cast<int>(_count.size()) ? _count[handle] : 0; }
+
+        void resize(size_t bodies)
+        {
+            if (bodies <= _count.size())
+                return;
+
+            _samples.resize(bodies * _capacity);
+            _head.resize(bodies, 0);
+            _count.resize(bodies, 0);
+        }
+
+        template <typename Derived>
+        void push(int handle, double time, const Eigen::MatrixBase<Derived>& pose)
+        {
+            resize(handle + 1);
+
+            // Out of order samples would break the search, keep only newer ones
+            if (_count[handle] && time <= at(handle, _count[handle] - 1).time)
+                return;
+
+            size_t slot = (_head[handle] + _count[handle]) % _capacity;
+            if (_count[handle] == _capacity)
+                _head[handle] = (_head[handle] + 1) % _capacity;
+            else
+                _count[handle]++;
+
+            PoseSample& sample = _samples[handle * _capacity + slot];
+            sample.time = time;
+            for (int i = 0; i < 7; i++)
+                sample.pose[i] = static_cast<double>(pose(i));
+        }
+
+        // i-th stored sample of the body, oldest first
+        const PoseSample& at(int handle, size_t i) const { return _samples[handle * _capacity + (_head[handle] + i) % _capacity]; }
+
+        const PoseSample& latest(int handle) const { return at(handle, _count[handle] - 1); }
+
+        // Index of the first sample at or after time (size(handle) if none)
+        size_t lowerBound(int handle, double time) const
+        {
+            size_t first = 0, count = size(handle);
+            while (count > 0) {
+                size_t step = count / 2;
+                if (at(handle, first + step).time < time) {
+                    first += step + 1;
+                    count -= step + 1;
+                }
+                else
+                    count = step;
+            }
+            return first;
+        }
+
+        // Samples with from <= time <= to, oldest first; returns how many were appended
+        size_t window(int handle, double from, double to, std::vector<PoseSample>& samples) const
+        {
+            size_t begin = samples.size();
+            for (size_t i = lowerBound(handle, from); i < size(handle) && at(handle, i).time <= to; i++)
+                samples.push_back(at(handle, i));
+            return samples.size() - begin;
+        }
+
+        void clear(int handle)
+        {
+            if (handle < static_cast<int>(_count.size()))
+                _head[handle] = _count[handle] = 0;
+        }
+
+    protected:
+        size_t _capacity;
+        std::vector<PoseSample> _samples;
+        std::vector<size_t> _head, _count;
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_POSEHISTORY_HPP
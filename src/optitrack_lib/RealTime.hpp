@@ -0,0 +1,95 @@
+#ifndef OPTITRACKLIB_REALTIME_HPP
+#define OPTITRACKLIB_REALTIME_HPP
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "optitrack_lib/Log.hpp"
+
+namespace optitrack_lib {
+    // Scheduling of one thread; the defaults leave it untouched
+    struct ThreadConfig {
+        std::vector<int> cpus; // allowed cores, empty keeps the current affinity
+        int priority = 0; // SCHED_FIFO priority (1-99), 0 keeps the current policy
+        std::string name; // shown by top/htop, at most 15 characters
+
+        bool empty() const { return cpus.empty() && !priority && name.empty(); }
+    };
+
+    struct RealTimeConfig {
+        ThreadConfig natnet; // NatNet receive thread (dataHandler), applied on its next frame
+        ThreadConfig commands; // command round trips
+        ThreadConfig watchdog;
+        ThreadConfig dispatch; // pose callback pool (onPoseChanged)
+        ThreadConfig resampler; // fixed-rate resampler timer (startResampler)
+        ThreadConfig jitterBuffer; // frame playout (enableJitterBuffer)
+        bool lockMemory = false; // mlockall and prefault the frame buffers
+    };
+
+    namespace realtime {
+        // Kernel thread ID, e.g. for taskset -p / chrt -p
+        inline pid_t threadId() { return static_cast<pid_t>(syscall(SYS_gettid)); }
+
+        // SCHED_FIFO and mlockall need CAP_SYS_NICE / CAP_IPC_LOCK or matching rlimits; failures are
+        // logged and reported, the rest of the configuration still applies
+        inline bool configure(pthread_t thread, const ThreadConfig& config)
+        {
+            bool ok = true;
+
+            if (!config.cpus.empty()) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                for (int cpu : config.cpus)
+                    CPU_SET(cpu, &set);
+                if (int error = pthread_setaffinity_np(thread, sizeof(set), &set)) {
+                    OPTITRACK_LOG_WARN("Unable to set the CPU affinity of thread %s: %s", config.name.c_str(), strerror(error));
+                    ok = false;
+                }
+            }
+
+            if (config.priority > 0) {
+                sched_param param = {};
+                param.sched_priority = config.priority;
+                if (int error = pthread_setschedparam(thread, SCHED_FIFO, &param)) {
+                    OPTITRACK_LOG_WARN("Unable to set SCHED_FIFO priority %d on thread %s: %s", config.priority, config.name.c_str(), strerror(error));
+                    ok = false;
+                }
+            }
+
+            if (!config.name.empty())
+                pthread_setname_np(thread, config.name.substr(0, 15).c_str());
+
+            return ok;
+        }
+
+        // For threads owned by the application (publisher, recorder, consumer loop)
+        inline bool configureCurrentThread(const ThreadConfig& config) { return configure(pthread_self(), config); }
+
+        // Lock current and future pages and touch stackBytes of the calling thread's stack, so that
+        // neither page faults nor swapping interrupt the real-time threads
+        inline bool lockMemory(size_t stackBytes = 256 * 1024)
+        {
+            if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+                OPTITRACK_LOG_WARN("Unable to lock memory: %s", strerror(errno));
+                return false;
+            }
+
+            volatile char* stack = static_cast<volatile char*>(alloca(stackBytes));
+            for (size_t i = 0; i < stackBytes; i += 4096)
+                stack[i] = 0;
+
+            return true;
+        }
+    } // namespace realtime
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_REALTIME_HPP
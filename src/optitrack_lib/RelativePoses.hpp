@@ -0,0 +1,79 @@
+#ifndef OPTITRACKLIB_RELATIVEPOSES_HPP
+#define OPTITRACKLIB_RELATIVEPOSES_HPP
+
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace optitrack_lib {
+    // Poses of bodies relative to reference bodies, T_reference_body = T_reference^-1 T_body, for all
+    // declared pairs in one pass over the pose table, with the quaternion products written out.
+    template <typename Scalar>
+    class RelativePoseBank {
+    public:
+        using Poses = Eigen::Array<Scalar, Eigen::Dynamic, 7>;
+        using Table = Eigen::Map<const Eigen::Matrix<Scalar, Eigen::Dynamic, 7, Eigen::RowMajor>>;
+        using Indices = Eigen::Array<Eigen::Index, Eigen::Dynamic, 1>;
+
+        size_t size() const { return _references.rows(); }
+
+        // Index of the pair, existing pairs are shared
+        int add(int reference, int body)
+        {
+            Eigen::Index n = _references.rows();
+            for (Eigen::Index i = 0; i < n; i++)
+                if (_references(i) == reference && _bodies(i) == body)
+                    return static_cast<int>(i);
+
+            _references.conservativeResize(n + 1);
+            _bodies.conservativeResize(n + 1);
+            _references(n) = reference;
+            _bodies(n) = body;
+            return static_cast<int>(n);
+        }
+
+        int reference(int pair) const { return static_cast<int>(_references(pair)); }
+
+        int body(int pair) const { return static_cast<int>(_bodies(pair)); }
+
+        // table: pose table indexed by handle (x y z qx qy qz qw), covering every handle of the pairs
+        const Poses& evaluate(const Table& table)
+        {
+            Eigen::Index n = _references.rows();
+            _relative.resize(n, 7);
+
+            // Straight from the rows of the table: gathering them into columns first costs more than the
+            // products themselves
+            for (Eigen::Index i = 0; i < n; i++) {
+                const Scalar* a = table.data() + 7 * _references(i);
+                const Scalar* b = table.data() + 7 * _bodies(i);
+                Scalar ax = a[3], ay = a[4], az = a[5], aw = a[6];
+                Scalar bx = b[3], by = b[4], bz = b[5], bw = b[6];
+
+                // Rotation: conj(q_a) q_b
+                _relative(i, 3) = aw * bx - ax * bw - ay * bz + az * by;
+                _relative(i, 4) = aw * by + ax * bz - ay * bw - az * bx;
+                _relative(i, 5) = aw * bz - ax * by + ay * bx - az * bw;
+                _relative(i, 6) = aw * bw + ax * bx + ay * by + az * bz;
+
+                // Translation: conj(q_a) (t_b - t_a), as v + w t + u x t with t = 2 u x v and u = -q_a.xyz
+                Scalar dx = b[0] - a[0], dy = b[1] - a[1], dz = b[2] - a[2];
+                Scalar tx = -2 * (ay * dz - az * dy), ty = -2 * (az * dx - ax * dz), tz = -2 * (ax * dy - ay * dx);
+                _relative(i, 0) = dx + aw * tx - (ay * tz - az * ty);
+                _relative(i, 1) = dy + aw * ty - (az * tx - ax * tz);
+                _relative(i, 2) = dz + aw * tz - (ax * ty - ay * tx);
+            }
+
+            return _relative;
+        }
+
+        // Results of the last evaluate()
+        const Poses& poses() const { return _relative; }
+
+    protected:
+        Indices _references, _bodies;
+        Poses _relative;
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_RELATIVEPOSES_HPP
@@ -0,0 +1,253 @@
+#ifndef OPTITRACKLIB_RESAMPLER_HPP
+#define OPTITRACKLIB_RESAMPLER_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "optitrack_lib/PoseHistory.hpp"
+
+namespace optitrack_lib {
+    enum class SampleKind : uint8_t {
+        Missing, // no sample of the body yet, identity pose
+        Interpolated, // between the two samples bracketing the time
+        Extrapolated, // beyond the newest sample, within maxExtrapolation
+        Held, // constant: past maxExtrapolation, across a tracking gap or before the oldest sample
+    };
+
+    struct ResamplerOptions {
+        double rate = 1000; // Hz, ticks of the timer thread
+
+        // The table is sampled at tick - delay: about one mocap period plus the transport latency keeps
+        // most samples interpolated, 0 extrapolates every tick for the lowest latency
+        double delay = 0;
+
+        // Seconds beyond the newest sample that a pose is extrapolated; further on it is held at the
+        // extrapolation bound, so the output stays continuous
+        double maxExtrapolation = 0.02;
+
+        // Samples further apart than this (seconds) are a tracking gap, neither interpolated nor
+        // extrapolated across
+        double maxGap = 0.1;
+
+        // The timer thread consumes new frames with updateData() before each tick; false when another
+        // loop of the application already calls updateData()
+        bool update = true;
+    };
+
+    // Pose table at an arbitrary time from the accepted history of every body. The two samples used
+    // for each body are found by binary search, then positions are interpolated linearly and
+    // orientations along the great circle (slerp) as array expressions across all bodies, so one tick
+    // is one vectorized pass whatever the number of bodies. Weights beyond 1 extrapolate.
+    class Resampler {
+    public:
+        using Array = Eigen::Array<double, Eigen::Dynamic, 1>;
+        using Poses = Eigen::Array<double, Eigen::Dynamic, 7>;
+
+        Resampler(const ResamplerOptions& options = ResamplerOptions()) : _options(options) {}
+
+        const ResamplerOptions& options() const { return _options; }
+
+        void setOptions(const ResamplerOptions& options) { _options = options; }
+
+        // Table of the first `bodies` handles at time (steady_clock seconds)
+        void sample(const PoseHistory& history, size_t bodies, double time)
+        {
+            Eigen::Index n = static_cast<Eigen::Index>(bodies);
+            if (_poses.rows() != n) {
+                _from.resize(n, 7);
+                _to.resize(n, 7);
+                _poses.resize(n, 7);
+                _weight.resize(n);
+                _sign.resize(n);
+                _theta.resize(n);
+                _sine.resize(n);
+                _ka.resize(n);
+                _kb.resize(n);
+                _kinds.resize(bodies);
+            }
+            _time = time;
+            _counts.fill(0);
+
+            for (Eigen::Index h = 0; h < n; h++) {
+                SampleKind kind = gather(history, static_cast<int>(h), time);
+                _kinds[h] = kind;
+                _counts[static_cast<size_t>(kind)]++;
+            }
+
+            // Positions
+            _poses.leftCols<3>() = _from.leftCols<3>() + (_to.leftCols<3>() - _from.leftCols<3>()).colwise() * _weight;
+
+            // Orientations: shortest arc, then sin((1 - w) theta) / sin(theta) and sin(w theta) / sin(theta),
+            // falling back to the linear weights for nearly equal quaternions. Scratch arrays are
+            // members, a tick does not allocate.
+            auto qa = _from.rightCols<4>();
+            auto qb = _to.rightCols<4>();
+            _theta = (qa * qb).rowwise().sum();
+            _sign = (_theta < 0).select(Array::Constant(n, -1.0), Array::Ones(n));
+            _theta = _theta.abs().min(1.0).acos();
+            _sine = _theta.sin();
+            _ka = (_sine < 1e-6).select(1.0 - _weight, ((1.0 - _weight) * _theta).sin() / _sine);
+            _kb = (_sine < 1e-6).select(_weight, (_weight * _theta).sin() / _sine) * _sign;
+            _poses.rightCols<4>() = qa.colwise() * _ka + qb.colwise() * _kb;
+            _sine = _poses.rightCols<4>().square().rowwise().sum().sqrt();
+            _poses.rightCols<4>().colwise() /= _sine;
+        }
+
+        // Time of the last table, steady_clock seconds
+        double time() const { return _time; }
+
+        size_t size() const { return _kinds.size(); }
+
+        // N x 7 table (x, y, z, qx, qy, qz, qw), one column per component
+        const Poses& poses() const { return _poses; }
+
+        Eigen::Matrix<double, 7, 1> pose(int handle) const { return _poses.row(handle).transpose().matrix(); }
+
+        SampleKind kind(int handle) const { return _kinds[handle]; }
+
+        const std::vector<SampleKind>& kinds() const { return _kinds; }
+
+        // Bodies of the last table with the given kind
+        size_t count(SampleKind kind) const { return _counts[static_cast<size_t>(kind)]; }
+
+    protected:
+        static void copy(const PoseSample& sample, Poses& poses, Eigen::Index h)
+        {
+            for (int i = 0; i < 7; i++)
+                poses(h, i) = sample.pose[i];
+        }
+
+        // Endpoints and weight of one body
+        SampleKind gather(const PoseHistory& history, int h, double time)
+        {
+            size_t size = history.size(h);
+            if (!size) {
+                _from.row(h) << 0, 0, 0, 0, 0, 0, 1;
+                _to.row(h) = _from.row(h);
+                _weight(h) = 0;
+                return SampleKind::Missing;
+            }
+
+            auto hold = [&](const PoseSample& sample) {
+                copy(sample, _from, h);
+                _to.row(h) = _from.row(h);
+                _weight(h) = 0;
+                return SampleKind::Held;
+            };
+
+            size_t i = history.lowerBound(h, time);
+            if (i == 0 && history.at(h, 0).time > time)
+                return hold(history.at(h, 0));
+
+            const PoseSample *a, *b;
+            SampleKind kind = SampleKind::Interpolated;
+            double t = time;
+            if (i < size && history.at(h, i).time == time) {
+                a = b = &history.at(h, i);
+            }
+            else if (i < size) {
+                a = &history.at(h, i - 1);
+                b = &history.at(h, i);
+                if (b->time - a->time > _options.maxGap)
+                    return hold(*a);
+            }
+            else {
+                if (size < 2)
+                    return hold(history.at(h, size - 1));
+
+                a = &history.at(h, size - 2);
+                b = &history.at(h, size - 1);
+                if (b->time - a->time > _options.maxGap)
+                    return hold(*b);
+
+                kind = time - b->time <= _options.maxExtrapolation ? SampleKind::Extrapolated : SampleKind::Held;
+                t = std::min(time, b->time + _options.maxExtrapolation);
+            }
+
+            copy(*a, _from, h);
+            copy(*b, _to, h);
+            _weight(h) = b->time > a->time ? (t - a->time) / (b->time - a->time) : 0.0;
+            return kind;
+        }
+
+        ResamplerOptions _options;
+        Poses _from, _to, _poses;
+        Array _weight, _sign, _theta, _sine, _ka, _kb;
+        std::vector<SampleKind> _kinds;
+        std::array<size_t, 4> _counts{};
+        double _time = 0;
+    };
+
+    // Calls tick(time, missed) at a fixed rate on its own thread. Ticks are scheduled on the steady
+    // clock from the first one, so the cadence does not drift with the work done; ticks that are late
+    // by more than a period are skipped rather than run in a burst, missed counts those skipped just
+    // before this one.
+    class ResampleTimer {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        ResampleTimer(double rate, std::function<void(Clock::time_point, uint64_t)> tick)
+            : _period(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / std::max(rate, 1e-3)))),
+              _tick(std::move(tick))
+        {
+            _thread = std::thread(&ResampleTimer::run, this);
+        }
+
+        ~ResampleTimer()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _condition.notify_one();
+            _thread.join();
+        }
+
+        uint64_t ticks() const { return _ticks.load(std::memory_order_relaxed); }
+
+        uint64_t missed() const { return _missed.load(std::memory_order_relaxed); }
+
+        std::thread& thread() { return _thread; }
+
+    protected:
+        void run()
+        {
+            Clock::time_point next = Clock::now();
+            uint64_t late = 0;
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (!_condition.wait_until(lock, next, [this] { return _stop; })) {
+                lock.unlock();
+                _tick(next, late);
+                _ticks.fetch_add(1, std::memory_order_relaxed);
+
+                next += _period;
+                Clock::time_point now = Clock::now();
+                late = now > next + _period ? static_cast<uint64_t>((now - next) / _period) : 0;
+                next += late * _period;
+                _missed.fetch_add(late, std::memory_order_relaxed);
+                lock.lock();
+            }
+        }
+
+        Clock::duration _period;
+        std::function<void(Clock::time_point, uint64_t)> _tick;
+
+        std::thread _thread;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        bool _stop = false;
+        std::atomic<uint64_t> _ticks{0}, _missed{0};
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_RESAMPLER_HPP
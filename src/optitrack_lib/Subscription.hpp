@@ -0,0 +1,97 @@
+#ifndef OPTITRACKLIB_SUBSCRIPTION_HPP
+#define OPTITRACKLIB_SUBSCRIPTION_HPP
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "optitrack_lib/Policies.hpp"
+
+namespace optitrack_lib {
+    // Data the server should stream to this client. Everything is subscribed by default; for example
+    //
+    //     Subscription subscription;
+    //     subscription.rigidBodies = {"Franka_17", "Obstacle_stick"};
+    //     subscription.markers = false;
+    //     subscription.skeletons = false;
+    //     client.subscribe(subscription);
+    struct Subscription {
+        // Rigid bodies by name; empty subscribes all of them
+        std::vector<std::string> rigidBodies;
+
+        bool markers = true; // markers of marker sets
+        bool labeledMarkers = true;
+        bool unlabeledMarkers = true;
+        bool skeletons = true;
+        bool forcePlates = true;
+        bool devices = true;
+
+        // Requested data bitstream version; all zeros keeps the server's
+        std::array<uint8_t, 4> bitstreamVersion = {0, 0, 0, 0};
+
+        // Whether the server has to filter anything at all
+        bool restricted() const
+        {
+            return !rigidBodies.empty() || !markers || !labeledMarkers || !unlabeledMarkers || !skeletons || !forcePlates || !devices;
+        }
+
+        bool pinnedBitstream() const { return bitstreamVersion[0] != 0; }
+
+        bool subscribed(const std::string& rigidBody) const
+        {
+            if (rigidBodies.empty())
+                return true;
+
+            for (const auto& name : rigidBodies)
+                if (name == rigidBody)
+                    return true;
+
+            return false;
+        }
+
+        // Categories to ingest on the client (rigid bodies are filtered by name instead)
+        uint32_t categories() const
+        {
+            return uint32_t(RigidBodies) | (markers ? uint32_t(MarkerSets) : 0u) | (labeledMarkers ? uint32_t(LabeledMarkers) : 0u)
+                | (unlabeledMarkers ? uint32_t(UnlabeledMarkers) : 0u) | (skeletons ? uint32_t(Skeletons) : 0u)
+                | (forcePlates ? uint32_t(ForcePlates) : 0u) | (devices ? uint32_t(Devices) : 0u);
+        }
+
+        // NatNet 4 data subscription commands; the first one clears any previous subscription
+        std::vector<std::string> commands() const
+        {
+            std::vector<std::string> commands;
+
+            if (pinnedBitstream())
+                commands.push_back("Bitstream," + std::to_string(bitstreamVersion[0]) + "." + std::to_string(bitstreamVersion[1]));
+
+            if (!restricted())
+                return commands;
+
+            commands.push_back("SubscribeToData,AllTypes,None");
+
+            if (rigidBodies.empty())
+                commands.push_back("SubscribeToData,RigidBody,All");
+            for (const auto& name : rigidBodies)
+                commands.push_back("SubscribeToData,RigidBody," + name);
+
+            if (markers)
+                commands.push_back("SubscribeToData,MarkerSetMarkers,All");
+            if (labeledMarkers)
+                commands.push_back("SubscribeToData,LabeledMarkers,All");
+            if (unlabeledMarkers)
+                commands.push_back("SubscribeToData,UnlabeledMarkers,All");
+            if (skeletons)
+                commands.push_back("SubscribeToData,Skeleton,All");
+            if (forcePlates)
+                commands.push_back("SubscribeToData,ForcePlate,All");
+            if (devices)
+                commands.push_back("SubscribeToData,Device,All");
+
+            return commands;
+        }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_SUBSCRIPTION_HPP
@@ -0,0 +1,232 @@
+#ifndef OPTITRACKLIB_SYNTHETICSOURCE_HPP
+#define OPTITRACKLIB_SYNTHETICSOURCE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <NatNet/NatNetTypes.h>
+
+namespace optitrack_lib {
+    struct SyntheticOptions {
+        int bodies = 50;
+        int markers = 0; // labeled markers per frame, spread over the bodies
+        double markerNoise = 0; // m, standard deviation of the marker positions
+        double markerOutlierProbability = 0; // markers displaced by markerOutlier
+        double markerOutlier = 0.03; // m
+        double rate = 240; // Hz; 0 delivers as fast as possible
+        double jitter = 0; // s, standard deviation of the delivery delay
+        double dropProbability = 0; // frames never delivered
+        double reorderProbability = 0; // frames held back and delivered after the next one
+        double hostClockFrequency = 1e7; // ticks per second of the host timestamps
+        uint32_t seed = 0;
+    };
+
+    // Deterministic NatNet frame generator standing in for a server, for benchmarks and replay tests.
+    // Bodies "Body_<i>" (streaming ID i + 1) follow smooth periodic trajectories; host timestamps are
+    // steady_clock time in host ticks, so exposure times are exact. Labeled marker i is member
+    // i / bodies + 1 of body i % bodies, placed by the body pose from the marker positions of its
+    // description.
+    class SyntheticSource {
+    public:
+        using Callback = std::function<void(sFrameOfMocapData*)>;
+
+        SyntheticSource(const SyntheticOptions& options = SyntheticOptions())
+            : _options(options), _generator(options.seed), _descriptions(new sDataDescriptions()), _bodyDescriptions(options.bodies)
+        {
+            _frames[0].reset(new sFrameOfMocapData());
+            _frames[1].reset(new sFrameOfMocapData());
+
+            // Marker layouts: members on a tilted ring, each body's markers contiguous
+            int markers = std::min(_options.markers, MAX_LABELED_MARKERS);
+            _markerPositions.reset(new MarkerData[std::max(markers, 1)]);
+            _markerOffsets.resize(options.bodies + 1, 0);
+            for (int i = 0; i < options.bodies; i++)
+                _markerOffsets[i + 1] = _markerOffsets[i] + markers / options.bodies + (i < markers % options.bodies);
+
+            _descriptions->nDataDescriptions = options.bodies;
+            for (int i = 0; i < options.bodies; i++) {
+                _bodyDescriptions[i].ID = i + 1;
+                std::snprintf(_bodyDescriptions[i].szName, MAX_NAMELENGTH, "Body_%d", i);
+                _bodyDescriptions[i].nMarkers = _markerOffsets[i + 1] - _markerOffsets[i];
+                _bodyDescriptions[i].MarkerPositions = _markerPositions.get() + _markerOffsets[i];
+                for (int k = 0; k < _bodyDescriptions[i].nMarkers; k++) {
+                    MarkerData& position = _bodyDescriptions[i].MarkerPositions[k];
+                    position[0] = static_cast<float>(0.05 * std::cos(2.4 * k + 0.1 * i));
+                    position[1] = static_cast<float>(0.05 * std::sin(2.4 * k + 0.1 * i));
+                    position[2] = static_cast<float>(0.015 * (k % 3));
+                }
+                _descriptions->arrDataDescriptions[i].type = Descriptor_RigidBody;
+                _descriptions->arrDataDescriptions[i].Data.RigidBodyDescription = &_bodyDescriptions[i];
+            }
+
+            _start = std::chrono::steady_clock::now();
+        }
+
+        ~SyntheticSource() { stop(); }
+
+        const SyntheticOptions& options() const { return _options; }
+
+        sDataDescriptions* descriptions() { return _descriptions.get(); }
+
+        // Generate the next frame without pacing; valid until the next call
+        sFrameOfMocapData* next()
+        {
+            _current ^= 1;
+            generate(*_frames[_current], std::chrono::steady_clock::now());
+            return _frames[_current].get();
+        }
+
+        // Deliver frames from a dedicated thread at the configured rate, jitter, drops and reordering
+        // (do not mix with next())
+        void start(Callback callback)
+        {
+            stop();
+            _running = true;
+            _thread = std::thread([this, callback]() { run(callback); });
+        }
+
+        void stop()
+        {
+            _running = false;
+            if (_thread.joinable())
+                _thread.join();
+        }
+
+        uint64_t generated() const { return _generated; }
+
+        uint64_t delivered() const { return _delivered; }
+
+        uint64_t dropped() const { return _dropped; }
+
+        uint64_t reordered() const { return _reordered; }
+
+    protected:
+        SyntheticOptions _options;
+        std::mt19937 _generator;
+
+        std::unique_ptr<sDataDescriptions> _descriptions;
+        std::vector<sRigidBodyDescription> _bodyDescriptions;
+        std::unique_ptr<MarkerData[]> _markerPositions;
+        std::vector<int> _markerOffsets;
+        std::unique_ptr<sFrameOfMocapData> _frames[2];
+        int _current = 0;
+
+        std::chrono::steady_clock::time_point _start;
+        int32_t _frameNumber = 0;
+
+        std::thread _thread;
+        std::atomic<bool> _running{false};
+        std::atomic<uint64_t> _generated{0}, _delivered{0}, _dropped{0}, _reordered{0};
+
+        void generate(sFrameOfMocapData& frame, std::chrono::steady_clock::time_point exposure)
+        {
+            double t = std::chrono::duration<double>(exposure - _start).count();
+            uint64_t ticks = static_cast<uint64_t>(std::chrono::duration<double>(exposure.time_since_epoch()).count() * _options.hostClockFrequency);
+
+            frame.iFrame = _frameNumber++;
+            frame.fTimestamp = t;
+            frame.CameraMidExposureTimestamp = ticks;
+            frame.CameraDataReceivedTimestamp = ticks + static_cast<uint64_t>(1e-3 * _options.hostClockFrequency);
+            frame.TransmitTimestamp = ticks + static_cast<uint64_t>(2e-3 * _options.hostClockFrequency);
+
+            frame.nRigidBodies = std::min(_options.bodies, MAX_RIGIDBODIES);
+            for (int i = 0; i < frame.nRigidBodies; i++) {
+                // Lissajous path around a per-body center, spinning about z
+                double phase = 0.37 * i, angle = 0.5 * (1.0 + 0.01 * i) * t + phase;
+                sRigidBodyData& body = frame.RigidBodies[i];
+                body.ID = i + 1;
+                body.x = static_cast<float>(0.1 * (i % 30) + 0.5 * std::sin(1.1 * t + phase));
+                body.y = static_cast<float>(0.1 * (i / 30) + 0.5 * std::sin(0.7 * t + 2 * phase));
+                body.z = static_cast<float>(1.0 + 0.2 * std::sin(0.3 * t + phase));
+                body.qx = body.qy = 0;
+                body.qz = static_cast<float>(std::sin(angle / 2));
+                body.qw = static_cast<float>(std::cos(angle / 2));
+                body.MeanError = 2e-4f;
+                body.params = 0x01;
+            }
+
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            std::normal_distribution<double> normal(0.0, std::max(_options.markerNoise, 1e-12));
+            frame.nLabeledMarkers = frame.nRigidBodies ? std::min(_options.markers, MAX_LABELED_MARKERS) : 0;
+            for (int i = 0; i < frame.nLabeledMarkers; i++) {
+                int b = i % frame.nRigidBodies, k = i / frame.nRigidBodies;
+                const sRigidBodyData& body = frame.RigidBodies[b];
+                const MarkerData& position = _bodyDescriptions[b].MarkerPositions[k];
+
+                // Bodies only spin about z
+                float c = 1 - 2 * body.qz * body.qz, s = 2 * body.qz * body.qw;
+                float error = _options.markerOutlierProbability > 0 && uniform(_generator) < _options.markerOutlierProbability ? static_cast<float>(_options.markerOutlier) : 0;
+
+                sMarker& marker = frame.LabeledMarkers[i];
+                marker.ID = (body.ID << 16) | (k + 1);
+                marker.x = body.x + c * position[0] - s * position[1] + error;
+                marker.y = body.y + s * position[0] + c * position[1];
+                marker.z = body.z + position[2];
+                if (_options.markerNoise > 0) {
+                    marker.x += static_cast<float>(normal(_generator));
+                    marker.y += static_cast<float>(normal(_generator));
+                    marker.z += static_cast<float>(normal(_generator));
+                }
+                marker.size = 0.01f;
+                marker.params = 0;
+                marker.residual = 1e-4f;
+            }
+
+            _generated++;
+        }
+
+        void run(Callback callback)
+        {
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            std::normal_distribution<double> normal(0.0, 1.0);
+            auto period = std::chrono::duration<double>(_options.rate > 0 ? 1.0 / _options.rate : 0.0);
+            auto schedule = std::chrono::steady_clock::now();
+            bool holding = false;
+
+            while (_running) {
+                if (_options.rate > 0)
+                    schedule += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+                else
+                    schedule = std::chrono::steady_clock::now();
+                _current ^= 1;
+                generate(*_frames[_current], schedule);
+
+                // Delivery delay is the positive part of a normal distribution
+                if (_options.rate > 0)
+                    std::this_thread::sleep_until(schedule + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(std::max(0.0, _options.jitter * normal(_generator)))));
+
+                if (uniform(_generator) < _options.dropProbability) {
+                    _dropped++;
+                    _current ^= 1;
+                    continue;
+                }
+
+                // Keep this frame in its buffer and generate the next one into the other
+                if (!holding && uniform(_generator) < _options.reorderProbability) {
+                    holding = true;
+                    _reordered++;
+                    continue;
+                }
+
+                callback(_frames[_current].get());
+                _delivered++;
+
+                if (holding) {
+                    callback(_frames[_current ^ 1].get());
+                    _delivered++;
+                    holding = false;
+                }
+            }
+        }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_SYNTHETICSOURCE_HPP
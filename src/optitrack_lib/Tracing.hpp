@@ -0,0 +1,282 @@
+#ifndef OPTITRACKLIB_TRACING_HPP
+#define OPTITRACKLIB_TRACING_HPP
+
+// Per-frame trace points of the receive-to-publish pipeline, exported as Chrome trace JSON (loads in
+// chrome://tracing and ui.perfetto.dev). Compiled in only with OPTITRACK_ENABLE_TRACING; when compiled
+// in, recording still has to be switched on with Tracer::instance().enable().
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "optitrack_lib/Log.hpp"
+
+namespace optitrack_lib {
+    struct TraceEvent {
+        const char* name; // string literal
+        uint64_t start; // steady_clock ns
+        uint64_t duration; // ns, complete events only
+        int64_t arg; // e.g. frame number, -1 for none
+        char phase; // 'X' complete, 'i' instant
+    };
+
+    // Single-writer ring of the events of one thread. The writer never waits; a dump copies the ring and
+    // discards the slots the writer may have overwritten meanwhile (seqlock style).
+    class TraceRing {
+    public:
+        TraceRing(size_t capacity, uint32_t tid, const std::string& name) : _events(capacity), _mask(capacity - 1), _tid(tid), _name(name) {}
+
+        void push(const TraceEvent& event)
+        {
+            uint64_t head = _head.load(std::memory_order_relaxed);
+            _events[head & _mask] = event;
+            _head.store(head + 1, std::memory_order_release);
+        }
+
+        void snapshot(std::vector<TraceEvent>& events) const
+        {
+            uint64_t head = _head.load(std::memory_order_acquire), capacity = _events.size();
+            uint64_t from = head > capacity ? head - capacity : 0;
+
+            size_t begin = events.size();
+            for (uint64_t i = from; i < head; i++)
+                events.push_back(_events[i & _mask]);
+
+            // Anything the writer may have reached while copying is stale, including the slot of the event
+            // it may be writing right now (index now)
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t now = _head.load(std::memory_order_relaxed);
+            uint64_t valid = now + 1 > capacity ? now - capacity + 1 : 0;
+            if (valid > from)
+                events.erase(events.begin() + begin, events.begin() + begin + std::min<uint64_t>(valid - from, head - from));
+        }
+
+        uint32_t tid() const { return _tid; }
+
+        const std::string& name() const { return _name; }
+
+        void rename(const std::string& name) { _name = name; }
+
+    protected:
+        std::vector<TraceEvent> _events;
+        uint64_t _mask;
+        uint32_t _tid;
+        std::string _name;
+        std::atomic<uint64_t> _head{0};
+    };
+
+    struct TraceTrigger {
+        double frameIntervalMillisec = 0; // dump when two frames arrive further apart; 0 disables
+        std::string path = "optitrack-trace"; // dumps are <path>-<n>.json
+        std::chrono::milliseconds after{50}; // keep recording this long after the anomaly
+        std::chrono::milliseconds cooldown{1000}; // minimum time between two dumps
+    };
+
+    // Process-wide set of per-thread rings (NatNet, command, consumer and user threads all record)
+    class Tracer {
+    public:
+        static Tracer& instance()
+        {
+            static Tracer tracer;
+            return tracer;
+        }
+
+        ~Tracer() { disarm(); }
+
+        // Events per thread, for rings created after the call; rounded up to a power of two
+        void setCapacity(size_t events)
+        {
+            size_t capacity = 1;
+            while (capacity < events)
+                capacity <<= 1;
+            _capacity = capacity;
+        }
+
+        void enable(bool enabled = true) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+        bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+        static uint64_t now() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+        void record(const char* name, uint64_t start, uint64_t duration, int64_t arg, char phase = 'X') { ring().push({name, start, duration, arg, phase}); }
+
+        // Name shown for the calling thread
+        void nameThread(const std::string& name)
+        {
+            TraceRing& r = ring();
+            std::lock_guard<std::mutex> lock(_mutex);
+            r.rename(name);
+        }
+
+        // Frame arrival mark; checks the anomaly trigger (call from the receive thread only)
+        void frame(int64_t frameNumber)
+        {
+            uint64_t t = now();
+            record("frame", t, 0, frameNumber, 'i');
+
+            double threshold = _threshold.load(std::memory_order_relaxed);
+            if (threshold > 0 && _lastFrame && (t - _lastFrame) * 1e-6 > threshold)
+                _triggered.store(true, std::memory_order_relaxed);
+            _lastFrame = t;
+        }
+
+        // Start dumping automatically on anomalies, from a background thread
+        void arm(const TraceTrigger& trigger)
+        {
+            disarm();
+            _trigger = trigger;
+            _threshold = trigger.frameIntervalMillisec;
+            _armed = true;
+            _dumper = std::thread([this]() { watch(); });
+        }
+
+        void disarm()
+        {
+            _threshold = 0;
+            _armed = false;
+            if (_dumper.joinable())
+                _dumper.join();
+        }
+
+        size_t dumps() const { return _dumps; }
+
+        // Chrome trace JSON of everything in the rings
+        bool dump(const std::string& path)
+        {
+            std::vector<std::pair<const TraceRing*, std::vector<TraceEvent>>> threads;
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (const auto& ring : _rings) {
+                threads.emplace_back(ring.get(), std::vector<TraceEvent>());
+                ring->snapshot(threads.back().second);
+            }
+
+            FILE* file = std::fopen(path.c_str(), "w");
+            if (!file)
+                return false;
+
+            std::fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+            bool first = true;
+            for (const auto& thread : threads) {
+                std::fprintf(file, "%s{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s\"}}", first ? "" : ",\n", thread.first->tid(), thread.first->name().c_str());
+                first = false;
+
+                for (const TraceEvent& e : thread.second) {
+                    std::fprintf(file, ",\n{\"ph\": \"%c\", \"name\": \"%s\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f", e.phase, e.name, thread.first->tid(), e.start * 1e-3);
+                    if (e.phase == 'X')
+                        std::fprintf(file, ", \"dur\": %.3f", e.duration * 1e-3);
+                    else
+                        std::fprintf(file, ", \"s\": \"t\"");
+                    if (e.arg >= 0)
+                        std::fprintf(file, ", \"args\": {\"frame\": %lld}", static_cast<long long>(e.arg));
+                    std::fprintf(file, "}");
+                }
+            }
+            std::fprintf(file, "\n]}\n");
+            std::fclose(file);
+            return true;
+        }
+
+    protected:
+        std::atomic<bool> _enabled{false};
+        std::atomic<size_t> _capacity{1 << 14};
+
+        std::mutex _mutex;
+        std::vector<std::shared_ptr<TraceRing>> _rings;
+        uint32_t _nextTid = 1;
+
+        uint64_t _lastFrame = 0;
+        std::atomic<double> _threshold{0};
+        std::atomic<bool> _triggered{false}, _armed{false};
+        std::atomic<size_t> _dumps{0};
+        TraceTrigger _trigger;
+        std::thread _dumper;
+
+        // The calling thread's ring, registered on first use; rings outlive their threads so that
+        // a dump still shows them
+        TraceRing& ring()
+        {
+            thread_local std::shared_ptr<TraceRing> ring;
+            if (!ring) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                ring = std::make_shared<TraceRing>(_capacity.load(), _nextTid, "thread " + std::to_string(_nextTid));
+                _nextTid++;
+                _rings.push_back(ring);
+            }
+            return *ring;
+        }
+
+        void watch()
+        {
+            auto last = std::chrono::steady_clock::now() - _trigger.cooldown;
+            while (_armed) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                if (!_triggered.exchange(false, std::memory_order_relaxed))
+                    continue;
+
+                if (std::chrono::steady_clock::now() - last < _trigger.cooldown)
+                    continue;
+
+                std::this_thread::sleep_for(_trigger.after);
+                std::string path = _trigger.path + "-" + std::to_string(_dumps) + ".json";
+                if (dump(path))
+                    OPTITRACK_LOG_WARN("Frame interval above %.1f ms, trace written to %s", _trigger.frameIntervalMillisec, path.c_str());
+                _dumps++;
+                last = std::chrono::steady_clock::now();
+            }
+        }
+    };
+
+    // Complete event covering the scope
+    class TraceScope {
+    public:
+        TraceScope(const char* name, int64_t arg = -1) : _name(name), _arg(arg), _start(Tracer::instance().enabled() ? Tracer::now() : 0) {}
+
+        ~TraceScope()
+        {
+            if (_start)
+                Tracer::instance().record(_name, _start, Tracer::now() - _start, _arg);
+        }
+
+    protected:
+        const char* _name;
+        int64_t _arg;
+        uint64_t _start;
+    };
+} // namespace optitrack_lib
+
+#define OPTITRACK_TRACE_CONCAT_(a, b) a##b
+#define OPTITRACK_TRACE_CONCAT(a, b) OPTITRACK_TRACE_CONCAT_(a, b)
+
+#ifdef OPTITRACK_ENABLE_TRACING
+// Scope event, name must be a string literal; the optional argument is recorded as the frame number
+#define OPTITRACK_TRACE_SCOPE(...) ::optitrack_lib::TraceScope OPTITRACK_TRACE_CONCAT(_traceScope, __LINE__)(__VA_ARGS__)
+#define OPTITRACK_TRACE_INSTANT(name, arg)                                                      \
+    do {                                                                                        \
+        if (::optitrack_lib::Tracer::instance().enabled())                                      \
+            ::optitrack_lib::Tracer::instance().record(name, ::optitrack_lib::Tracer::now(), 0, arg, 'i'); \
+    } while (0)
+#define OPTITRACK_TRACE_FRAME(frameNumber)                            \
+    do {                                                              \
+        if (::optitrack_lib::Tracer::instance().enabled())            \
+            ::optitrack_lib::Tracer::instance().frame(frameNumber);   \
+    } while (0)
+// Names the calling thread in the trace, once per thread and call site
+#define OPTITRACK_TRACE_THREAD(name)                                                                        \
+    do {                                                                                                    \
+        static thread_local bool _traceNamed = (::optitrack_lib::Tracer::instance().nameThread(name), true); \
+        (void)_traceNamed;                                                                                  \
+    } while (0)
+#else
+#define OPTITRACK_TRACE_SCOPE(...) ((void)0)
+#define OPTITRACK_TRACE_INSTANT(name, arg) ((void)0)
+#define OPTITRACK_TRACE_FRAME(frameNumber) ((void)0)
+#define OPTITRACK_TRACE_THREAD(name) ((void)0)
+#endif
+
+#endif // OPTITRACKLIB_TRACING_HPP
@@ -0,0 +1,160 @@
+#ifndef OPTITRACKLIB_WATCHDOG_HPP
+#define OPTITRACKLIB_WATCHDOG_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace optitrack_lib {
+    struct WatchdogOptions {
+        // Interval between two checks of the frame counter
+        std::chrono::milliseconds period = std::chrono::milliseconds(20);
+
+        // Stream is stale after this many expected frame periods without data (and at least minStaleTime)
+        double staleFrames = 10;
+        std::chrono::milliseconds minStaleTime = std::chrono::milliseconds(100);
+
+        // Reconnect backoff, doubled after each attempt that did not bring frames back
+        std::chrono::milliseconds initialBackoff = std::chrono::milliseconds(100);
+        std::chrono::milliseconds maxBackoff = std::chrono::milliseconds(5000);
+
+        // Assumed rate while the server has not reported its own
+        double defaultRate = 120;
+    };
+
+    struct WatchdogStats {
+        double expectedRate = 0;
+        double measuredRate = 0;
+        double lastFrameAge = 0; // seconds
+        bool stale = false;
+        size_t attempts = 0; // reconnects tried
+        size_t reconnects = 0; // successful ones, like optitrack_reconnects_total
+        size_t failedReconnects = 0;
+        double lastReconnectMillisec = 0; // duration of the last reconnect that brought frames back
+    };
+
+    // Watches the frame arrival rate and reconnects with backoff when frames stop
+    class Watchdog {
+    public:
+        Watchdog(std::function<uint64_t()> frames, std::function<double()> expectedRate, std::function<bool()> reconnect, const WatchdogOptions& options = WatchdogOptions())
+            : _frames(std::move(frames)), _expectedRate(std::move(expectedRate)), _reconnect(std::move(reconnect)), _options(options)
+        {
+            _thread = std::thread(&Watchdog::run, this);
+        }
+
+        ~Watchdog()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _condition.notify_one();
+            _thread.join();
+        }
+
+        WatchdogStats stats()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _stats;
+        }
+
+        std::thread& thread() { return _thread; }
+
+    protected:
+        using Clock = std::chrono::steady_clock;
+
+        std::function<uint64_t()> _frames;
+        std::function<double()> _expectedRate;
+        std::function<bool()> _reconnect;
+        WatchdogOptions _options;
+
+        std::thread _thread;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        bool _stop = false;
+        WatchdogStats _stats;
+
+        // Returns false when stopped during the wait
+        bool wait(Clock::duration duration)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            return !_condition.wait_for(lock, duration, [this] { return _stop; });
+        }
+
+        void run()
+        {
+            uint64_t lastCount = _frames();
+            Clock::time_point lastChange = Clock::now(), lastCheck = lastChange, reconnectStart;
+            Clock::duration backoff = _options.initialBackoff;
+            bool reconnecting = false;
+            double measuredRate = 0;
+
+            while (wait(_options.period)) {
+                Clock::time_point now = Clock::now();
+                uint64_t count = _frames();
+
+                double dt = std::chrono::duration<double>(now - lastCheck).count();
+                measuredRate += 0.2 * ((count - lastCount) / dt - measuredRate);
+                lastCheck = now;
+
+                if (count != lastCount) {
+                    lastCount = count;
+                    lastChange = now;
+
+                    // Frames are back
+                    if (reconnecting) {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        _stats.lastReconnectMillisec = std::chrono::duration<double, std::milli>(now - reconnectStart).count();
+                        reconnecting = false;
+                        backoff = _options.initialBackoff;
+                    }
+                }
+
+                double expectedRate = _expectedRate();
+                if (expectedRate <= 0)
+                    expectedRate = _options.defaultRate;
+
+                Clock::duration staleTime = std::max<Clock::duration>(_options.minStaleTime,
+                    std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(_options.staleFrames / expectedRate)));
+                bool stale = now - lastChange > staleTime;
+
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _stats.expectedRate = expectedRate;
+                    _stats.measuredRate = measuredRate;
+                    _stats.lastFrameAge = std::chrono::duration<double>(now - lastChange).count();
+                    _stats.stale = stale;
+                }
+
+                if (!stale)
+                    continue;
+
+                if (!reconnecting) {
+                    reconnecting = true;
+                    reconnectStart = now;
+                }
+
+                bool connected = _reconnect();
+
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _stats.attempts++;
+                    if (connected)
+                        _stats.reconnects++;
+                    else
+                        _stats.failedReconnects++;
+                }
+
+                // Give the stream time to come back before the next attempt
+                if (!wait(backoff))
+                    return;
+                backoff = std::min<Clock::duration>(2 * backoff, _options.maxBackoff);
+            }
+        }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_WATCHDOG_HPP
@@ -0,0 +1,458 @@
+#ifndef OPTITRACKLIB_ZONES_HPP
+#define OPTITRACKLIB_ZONES_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+namespace optitrack_lib {
+    enum class ZoneShape {
+        Box, // halfExtents
+        Sphere, // radius
+        Capsule // segment of +-halfLength along the local z axis, radius
+    };
+
+    // Volume fixed in the world (body < 0) or attached to a body, at offset/rotation in its frame
+    struct Zone {
+        ZoneShape shape = ZoneShape::Sphere;
+        Eigen::Vector3d halfExtents = Eigen::Vector3d::Zero();
+        double radius = 0;
+        double halfLength = 0;
+        int body = -1;
+        Eigen::Vector3d offset = Eigen::Vector3d::Zero();
+        Eigen::Quaterniond rotation = Eigen::Quaterniond::Identity();
+        std::string name;
+
+        static Zone box(const Eigen::Vector3d& halfExtents, int body = -1)
+        {
+            Zone zone;
+            zone.shape = ZoneShape::Box;
+            zone.halfExtents = halfExtents;
+            zone.body = body;
+            return zone;
+        }
+
+        static Zone sphere(double radius, int body = -1)
+        {
+            Zone zone;
+            zone.shape = ZoneShape::Sphere;
+            zone.radius = radius;
+            zone.body = body;
+            return zone;
+        }
+
+        static Zone capsule(double halfLength, double radius, int body = -1)
+        {
+            Zone zone;
+            zone.shape = ZoneShape::Capsule;
+            zone.halfLength = halfLength;
+            zone.radius = radius;
+            zone.body = body;
+            return zone;
+        }
+    };
+
+    // A body (any body but the zone's own for body < 0) enters when its origin comes within distance of
+    // the zone (0: inside it) and exits once it is further than distance + hysteresis. A sphere of
+    // radius 0 attached to a body turns the rule into body to body proximity.
+    struct ZoneRule {
+        int zone = 0;
+        int body = -1;
+        double distance = 0; // m
+        double hysteresis = 0.01; // m
+    };
+
+    enum class ZoneEventType : uint8_t {
+        Enter,
+        Exit
+    };
+
+    struct ZoneEvent {
+        ZoneEventType type;
+        int rule, zone, body;
+        double distance; // signed distance to the zone surface, negative inside
+        int32_t frame;
+        std::chrono::steady_clock::time_point exposure;
+    };
+
+    // Bounded lock-free MPMC queue (Vyukov); a push on a full queue fails
+    template <typename T, size_t Capacity>
+    class BoundedQueue {
+    public:
+        static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+        BoundedQueue() : _cells(new Cell[Capacity])
+        {
+            for (size_t i = 0; i < Capacity; i++)
+                _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        bool push(const T& value)
+        {
+            uint64_t position = _enqueue.load(std::memory_order_relaxed);
+            while (true) {
+                Cell& cell = _cells[position & (Capacity - 1)];
+                int64_t difference = static_cast<int64_t>(cell.sequence.load(std::memory_order_acquire)) - static_cast<int64_t>(position);
+                if (difference == 0) {
+                    if (_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        cell.value = value;
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                    return false;
+                else
+                    position = _enqueue.load(std::memory_order_relaxed);
+            }
+        }
+
+        bool pop(T& value)
+        {
+            uint64_t position = _dequeue.load(std::memory_order_relaxed);
+            while (true) {
+                Cell& cell = _cells[position & (Capacity - 1)];
+                int64_t difference = static_cast<int64_t>(cell.sequence.load(std::memory_order_acquire)) - static_cast<int64_t>(position + 1);
+                if (difference == 0) {
+                    if (_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        value = cell.value;
+                        cell.sequence.store(position + Capacity, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                    return false;
+                else
+                    position = _dequeue.load(std::memory_order_relaxed);
+            }
+        }
+
+    protected:
+        struct Cell {
+            std::atomic<uint64_t> sequence;
+            T value;
+        };
+
+        std::unique_ptr<Cell[]> _cells;
+        alignas(64) std::atomic<uint64_t> _enqueue{0};
+        alignas(64) std::atomic<uint64_t> _dequeue{0};
+    };
+
+    // Zone rules evaluated once per frame. Body origins are queried against a bounding volume
+    // hierarchy of the zones' world boxes (grown by their rules' reach), refit every frame and rebuilt
+    // when refitting has degraded it; only candidates get an exact signed distance test. Events go to
+    // a lock-free queue that any thread may drain.
+    class ZoneEngine {
+    public:
+        static constexpr size_t kEventCapacity = 4096;
+
+        int addZone(const Zone& zone)
+        {
+            _zones.push_back({zone, 0, {}, Eigen::Isometry3d::Identity(), Eigen::AlignedBox3d()});
+            _dirty = true;
+            return static_cast<int>(_zones.size() - 1);
+        }
+
+        // -1 when rule.zone is not a zone index
+        int addRule(const ZoneRule& rule)
+        {
+            if (rule.zone < 0 || static_cast<size_t>(rule.zone) >= _zones.size())
+                return -1;
+
+            int index = static_cast<int>(_rules.size());
+            _rules.push_back({rule, {}});
+            ZoneState& zone = _zones[rule.zone];
+            zone.rules.push_back(index);
+            zone.reach = std::max(zone.reach, rule.distance + rule.hysteresis);
+            return index;
+        }
+
+        size_t zones() const { return _zones.size(); }
+
+        size_t rules() const { return _rules.size(); }
+
+        bool poll(ZoneEvent& event) { return _events.pop(event); }
+
+        uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+        uint64_t rebuilds() const { return _rebuilds; }
+
+        // table: N x 7 pose table indexed by handle (x y z qx qy qz qw); updated: bodies with a new sample
+        // in this frame, the others keep their state
+        template <typename Table, typename Mask>
+        void update(const Table& table, const Mask& updated, int32_t frame, std::chrono::steady_clock::time_point exposure)
+        {
+            if (_rules.empty())
+                return;
+
+            Eigen::Index bodies = table.rows();
+            _stamp++;
+
+            // World placement and bounds of every zone, then refit (or rebuild) the hierarchy
+            for (ZoneState& zone : _zones) {
+                Eigen::Isometry3d base = Eigen::Isometry3d::Identity();
+                if (zone.zone.body >= 0 && zone.zone.body < bodies)
+                    base = pose(table, zone.zone.body);
+                zone.world = base * Eigen::Translation3d(zone.zone.offset) * zone.zone.rotation;
+                zone.bounds = bounds(zone);
+            }
+            if (_dirty)
+                build();
+            else if (refit() > 2 * _builtArea)
+                build();
+
+            for (Eigen::Index b = 0; b < bodies; b++) {
+                if (!updated(b))
+                    continue;
+
+                Eigen::Vector3d point(table(b, 0), table(b, 1), table(b, 2));
+                query(point, [&](int z) {
+                    const ZoneState& zone = _zones[z];
+                    if (zone.zone.body == b)
+                        return;
+                    double distance = signedDistance(zone, point);
+                    for (int r : zone.rules)
+                        if (_rules[r].rule.body < 0 || _rules[r].rule.body == b)
+                            evaluate(r, static_cast<int>(b), distance, frame, exposure);
+                });
+            }
+
+            // Inside bodies the hierarchy did not return are beyond the zone's reach: exit. Bodies
+            // without a sample in this frame keep their state.
+            for (size_t i = 0; i < _inside.size();) {
+                Inside& inside = _inside[i];
+                if (inside.stamp == _stamp || inside.body >= bodies || !updated(inside.body)) {
+                    i++;
+                    continue;
+                }
+                const ZoneState& zone = _zones[_rules[inside.rule].rule.zone];
+                Eigen::Vector3d point(table(inside.body, 0), table(inside.body, 1), table(inside.body, 2));
+                emit(ZoneEventType::Exit, inside.rule, inside.body, signedDistance(zone, point), frame, exposure);
+                leave(i);
+            }
+        }
+
+        // Signed distance of a world point to the zone, negative inside
+        double distance(int zone, const Eigen::Vector3d& point) const { return signedDistance(_zones[zone], point); }
+
+    protected:
+        struct ZoneState {
+            Zone zone;
+            double reach; // largest distance + hysteresis of its rules
+            std::vector<int> rules;
+            Eigen::Isometry3d world;
+            Eigen::AlignedBox3d bounds;
+        };
+
+        struct RuleState {
+            ZoneRule rule;
+            std::vector<int> inside; // per body, 1 + index in _inside, 0 when outside
+        };
+
+        // Entered (rule, body) pairs; stamp is the last frame their zone was returned for the body
+        struct Inside {
+            int rule, body;
+            uint64_t stamp;
+        };
+
+        // Children follow their parent, so a reverse sweep refits bottom-up
+        struct Node {
+            Eigen::AlignedBox3d bounds;
+            int left = -1, right = -1; // children, or left = -1 - zone for leaves
+        };
+
+        std::vector<ZoneState> _zones;
+        std::vector<RuleState> _rules;
+        std::vector<Inside> _inside;
+        std::vector<Node> _nodes;
+        std::vector<int> _order, _stack;
+        double _builtArea = 0;
+        bool _dirty = true;
+        uint64_t _stamp = 0, _rebuilds = 0;
+
+        BoundedQueue<ZoneEvent, kEventCapacity> _events;
+        std::atomic<uint64_t> _dropped{0};
+
+        template <typename Table>
+        static Eigen::Isometry3d pose(const Table& table, Eigen::Index row)
+        {
+            Eigen::Quaterniond q(table(row, 6), table(row, 3), table(row, 4), table(row, 5));
+            if (q.squaredNorm() < 1e-12)
+                q = Eigen::Quaterniond::Identity();
+            return Eigen::Translation3d(table(row, 0), table(row, 1), table(row, 2)) * q.normalized();
+        }
+
+        static Eigen::AlignedBox3d bounds(const ZoneState& zone)
+        {
+            Eigen::Vector3d center = zone.world.translation(), extent = Eigen::Vector3d::Zero();
+            switch (zone.zone.shape) {
+            case ZoneShape::Box:
+                extent = zone.world.linear().cwiseAbs() * zone.zone.halfExtents;
+                break;
+            case ZoneShape::Sphere:
+                extent.setConstant(zone.zone.radius);
+                break;
+            case ZoneShape::Capsule:
+                extent = (zone.world.linear().col(2) * zone.zone.halfLength).cwiseAbs() + Eigen::Vector3d::Constant(zone.zone.radius);
+                break;
+            }
+            extent.array() += zone.reach;
+            return Eigen::AlignedBox3d(center - extent, center + extent);
+        }
+
+        static double signedDistance(const ZoneState& zone, const Eigen::Vector3d& point)
+        {
+            Eigen::Vector3d p = zone.world.inverse(Eigen::Isometry) * point;
+            switch (zone.zone.shape) {
+            case ZoneShape::Box: {
+                Eigen::Vector3d q = p.cwiseAbs() - zone.zone.halfExtents;
+                return q.cwiseMax(0.0).norm() + std::min(q.maxCoeff(), 0.0);
+            }
+            case ZoneShape::Sphere:
+                return p.norm() - zone.zone.radius;
+            case ZoneShape::Capsule:
+                p.z() -= std::clamp(p.z(), -zone.zone.halfLength, zone.zone.halfLength);
+                return p.norm() - zone.zone.radius;
+            }
+            return 0;
+        }
+
+        static double area(const Eigen::AlignedBox3d& box)
+        {
+            Eigen::Vector3d size = box.sizes();
+            return 2 * (size.x() * size.y() + size.y() * size.z() + size.z() * size.x());
+        }
+
+        // Median split along the widest axis of the zone centers
+        void build()
+        {
+            _nodes.clear();
+            _order.resize(_zones.size());
+            std::iota(_order.begin(), _order.end(), 0);
+            if (!_zones.empty())
+                build(0, static_cast<int>(_order.size()));
+
+            _builtArea = 0;
+            for (const Node& node : _nodes)
+                _builtArea += area(node.bounds);
+            _dirty = false;
+            _rebuilds++;
+        }
+
+        int build(int begin, int end)
+        {
+            int index = static_cast<int>(_nodes.size());
+            _nodes.emplace_back();
+
+            Eigen::AlignedBox3d box, centers;
+            for (int i = begin; i < end; i++) {
+                box.extend(_zones[_order[i]].bounds);
+                centers.extend(_zones[_order[i]].bounds.center());
+            }
+            _nodes[index].bounds = box;
+
+            if (end - begin == 1) {
+                _nodes[index].left = -1 - _order[begin];
+                return index;
+            }
+
+            Eigen::Index axis;
+            centers.sizes().maxCoeff(&axis);
+            int middle = (begin + end) / 2;
+            std::nth_element(_order.begin() + begin, _order.begin() + middle, _order.begin() + end,
+                [&](int a, int b) { return _zones[a].bounds.center()(axis) < _zones[b].bounds.center()(axis); });
+
+            int left = build(begin, middle);
+            int right = build(middle, end);
+            _nodes[index].left = left;
+            _nodes[index].right = right;
+            return index;
+        }
+
+        // Returns the total surface area of the refit hierarchy
+        double refit()
+        {
+            double total = 0;
+            for (int i = static_cast<int>(_nodes.size()) - 1; i >= 0; i--) {
+                Node& node = _nodes[i];
+                if (node.left < 0)
+                    node.bounds = _zones[-1 - node.left].bounds;
+                else
+                    node.bounds = _nodes[node.left].bounds.merged(_nodes[node.right].bounds);
+                total += area(node.bounds);
+            }
+            return total;
+        }
+
+        template <typename Visitor>
+        void query(const Eigen::Vector3d& point, Visitor&& visit)
+        {
+            if (_nodes.empty())
+                return;
+
+            _stack.clear();
+            _stack.push_back(0);
+            while (!_stack.empty()) {
+                const Node& node = _nodes[_stack.back()];
+                _stack.pop_back();
+                if (!node.bounds.contains(point))
+                    continue;
+
+                if (node.left < 0)
+                    visit(-1 - node.left);
+                else {
+                    _stack.push_back(node.left);
+                    _stack.push_back(node.right);
+                }
+            }
+        }
+
+        void evaluate(int r, int body, double distance, int32_t frame, std::chrono::steady_clock::time_point exposure)
+        {
+            RuleState& rule = _rules[r];
+            if (rule.inside.size() <= static_cast<size_t>(body))
+                rule.inside.resize(body + 1, 0);
+
+            if (int slot = rule.inside[body]) {
+                if (distance > rule.rule.distance + rule.rule.hysteresis) {
+                    leave(slot - 1);
+                    emit(ZoneEventType::Exit, r, body, distance, frame, exposure);
+                }
+                else
+                    _inside[slot - 1].stamp = _stamp;
+            }
+            else if (distance <= rule.rule.distance) {
+                _inside.push_back({r, body, _stamp});
+                rule.inside[body] = static_cast<int>(_inside.size());
+                emit(ZoneEventType::Enter, r, body, distance, frame, exposure);
+            }
+        }
+
+        // Remove entry i of _inside, the last entry takes its place
+        void leave(size_t i)
+        {
+            _rules[_inside[i].rule].inside[_inside[i].body] = 0;
+            if (i + 1 != _inside.size()) {
+                _inside[i] = _inside.back();
+                _rules[_inside[i].rule].inside[_inside[i].body] = static_cast<int>(i + 1);
+            }
+            _inside.pop_back();
+        }
+
+        void emit(ZoneEventType type, int rule, int body, double distance, int32_t frame, std::chrono::steady_clock::time_point exposure)
+        {
+            if (!_events.push({type, rule, _rules[rule].rule.zone, body, distance, frame, exposure}))
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+} // namespace optitrack_lib
+
+#endif // OPTITRACKLIB_ZONES_HPP
@@ -0,0 +1,87 @@
+#include <pybind11/chrono.h>
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <optitrack_lib/Optitrack.hpp>
+
+namespace py = pybind11;
+using namespace optitrack_lib;
+
+namespace {
+    // Read-only array over memory owned by the client; the client is kept alive as the array base. The
+    // table never moves (it holds at most MAX_RIGIDBODIES handles), so the view cannot dangle, but its
+    // rows are the bodies known when it was taken.
+    py::array view(Optitrack& self, py::handle owner)
+    {
+        auto poses = self.poses();
+        py::array_t<double> array({poses.rows(), Eigen::Index(7)}, {Eigen::Index(7 * sizeof(double)), Eigen::Index(sizeof(double))}, poses.data(), owner);
+        array.attr("flags").attr("writeable") = false;
+        return array;
+    }
+} // namespace
+
+PYBIND11_MODULE(optitrack_lib, m)
+{
+    m.doc() = "NatNet client with zero-copy NumPy access to the pose table";
+
+    PYBIND11_NUMPY_DTYPE(PoseSample, time, pose);
+
+    py::enum_<SampleStatus>(m, "SampleStatus")
+        .value("Valid", SampleValid)
+        .value("Invalid", SampleInvalid)
+        .value("Outlier", SampleOutlier);
+
+    py::enum_<FilterType>(m, "FilterType")
+        .value("Off", FilterType::None)
+        .value("OneEuro", FilterType::OneEuro)
+        .value("Kalman", FilterType::Kalman);
+
+    // Time base of timestamps and history queries
+    m.def("now", []() { return Optitrack::toSeconds(std::chrono::steady_clock::now()); }, "steady_clock seconds");
+
+    py::class_<Optitrack>(m, "Optitrack")
+        .def(py::init<>())
+        // Network round trips and waits release the GIL so that other Python threads keep running
+        .def("connect", py::overload_cast<const std::string&, const std::string&>(&Optitrack::connect), py::arg("server") = "", py::arg("local") = "", py::call_guard<py::gil_scoped_release>())
+        .def("update_data_descriptions", &Optitrack::updateDataDescriptions, py::call_guard<py::gil_scoped_release>())
+        .def("update_data", &Optitrack::updateData, py::call_guard<py::gil_scoped_release>())
+        .def("wait_for_frame", [](Optitrack& self, double timeout) { return self.waitForFrame(std::chrono::milliseconds(static_cast<int64_t>(timeout * 1000))); }, py::arg("timeout") = 1.0, py::call_guard<py::gil_scoped_release>(), "Block until a new frame arrives (timeout in seconds); False on timeout")
+        .def("enable_watchdog", [](Optitrack& self) { self.enableWatchdog(); })
+        .def("enable_filter", [](Optitrack& self, FilterType type) { self.enableFilter(type); })
+        .def("disable_filter", &Optitrack::disableFilter)
+        .def("enable_history", &Optitrack::enableHistory, py::arg("samples") = 1024)
+        .def("frame_rate", &Optitrack::frameRate)
+        .def("handle", &Optitrack::handle, "Handle of the body, -1 once the table is full")
+        .def("name", &Optitrack::name)
+        .def("num_bodies", &Optitrack::numBodies)
+        .def("status", &Optitrack::status)
+        .def("age", &Optitrack::age)
+        .def("timestamp", [](Optitrack& self, int handle) { return Optitrack::toSeconds(self.timestamp(handle)); })
+        .def("frame_time", [](Optitrack& self) { return Optitrack::toSeconds(self.frameTime()); })
+        .def("rigid_body", [](Optitrack& self, int handle) {
+            Eigen::Matrix<double, 7, 1> pose = self.rigidBody(handle);
+            return py::array_t<double>(7, pose.data());
+        })
+        .def("rigid_body", [](Optitrack& self, const std::string& name) {
+            Eigen::Matrix<double, 7, 1> pose = self.rigidBody(name);
+            return py::array_t<double>(7, pose.data());
+        })
+        .def(
+            "poses", [](py::object self) { return view(self.cast<Optitrack&>(), self); },
+            "Zero-copy N x 7 read-only view (x, y, z, qx, qy, qz, qw per handle), refreshed in place by update_data(). "
+            "N is num_bodies() when the view is taken: bodies added later (handle() or a description refresh) "
+            "need a new view.")
+        .def(
+            "history", [](Optitrack& self, int handle, double from, double to) {
+                std::vector<PoseSample> samples;
+                {
+                    py::gil_scoped_release release;
+                    samples = self.history(handle, from, to);
+                }
+                py::array_t<PoseSample> array(samples.size());
+                std::copy(samples.begin(), samples.end(), array.mutable_data());
+                return array;
+            },
+            py::arg("handle"), py::arg("start"), py::arg("end"), "Structured array (time, pose[7]) of the samples with start <= time <= end");
+}
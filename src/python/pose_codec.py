@@ -0,0 +1,106 @@
+#!/usr/bin/env python
+# encoding: utf-8
+#
+#    This file is part of optitrack-lib.
+#
+#    Copyright (c) 2023 Bernardo Fichera <bernardo.fichera@gmail.com>
+#
+#    Permission is hereby granted, free of charge, to any person obtaining a copy
+#    of this software and associated documentation files (the "Software"), to deal
+#    in the Software without restriction, including without limitation the rights
+#    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+#    copies of the Software, and to permit persons to whom the Software is
+#    furnished to do so, subject to the following conditions:
+#
+#    The above copyright notice and this permission notice shall be included in all
+#    copies or substantial portions of the Software.
+#
+#    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+#    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+#    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+#    SOFTWARE.
+
+"""Pure NumPy decoder of the packets of optitrack_lib/PoseCodec.hpp."""
+
+import struct
+
+import numpy as np
+
+VERSION = 1
+KEYFRAME = 0x01
+HEADER = struct.Struct("<BBHHHIf6B")
+QUATERNION_SCALE = 32767.0 * np.sqrt(2.0)
+
+
+def _unpack(bits, offset, n, width):
+    """n little-endian unsigned integers of the given bit width starting at offset."""
+    if width == 0:
+        return np.zeros(n, dtype=np.uint64)
+    chunk = bits[offset:offset + n * width].reshape(n, width).astype(np.uint64)
+    return (chunk << np.arange(width, dtype=np.uint64)).sum(axis=1, dtype=np.uint64)
+
+
+def _unzigzag(values):
+    return (values >> np.uint64(1)).astype(np.int64) ^ -(values & np.uint64(1)).astype(np.int64)
+
+
+class PoseDecoder:
+    def __init__(self):
+        self.keyframe = None
+        self.keyframe_sequence = None
+        self.sequence = None
+        self.poses = np.zeros((0, 7))
+
+    def decode(self, packet):
+        """Decode one packet (bytes or uint8 array, possibly padded); returns the N x 7
+        poses, or None if the packet is malformed or its keyframe was lost."""
+        data = np.frombuffer(packet, dtype=np.uint8)
+        if data.size < HEADER.size or data[0] != VERSION:
+            return None
+
+        version, flags, sequence, keyframe_sequence, n, size, resolution, *widths = HEADER.unpack_from(data.tobytes()[:HEADER.size])
+        if size > data.size or size < HEADER.size or any(w > 64 for w in widths):
+            return None
+
+        keyframe = bool(flags & KEYFRAME)
+        if not keyframe and (self.keyframe is None or keyframe_sequence != self.keyframe_sequence or self.keyframe.shape[0] != n):
+            return None
+
+        bits = np.unpackbits(data[HEADER.size:size], bitorder="little")
+        if 2 * n + n * sum(widths) > bits.size:
+            return None
+
+        index = _unpack(bits, 0, n, 2).astype(np.int64)
+        offset = 2 * n
+        integers = np.empty((n, 6), dtype=np.int64)
+        for c, width in enumerate(widths):
+            integers[:, c] = _unzigzag(_unpack(bits, offset, n, width))
+            offset += n * width
+
+        if keyframe:
+            self.keyframe = integers
+            self.keyframe_sequence = keyframe_sequence
+        else:
+            integers = integers + self.keyframe
+
+        poses = np.empty((n, 7))
+        poses[:, :3] = integers[:, :3] * float(resolution)
+
+        small = integers[:, 3:] / QUATERNION_SCALE
+        largest = np.sqrt(np.maximum(1.0 - (small ** 2).sum(axis=1), 0.0))
+
+        # Component k is the dropped one, or slot k (k < index) or slot k - 1 (k > index)
+        for k in range(4):
+            value = largest.copy()
+            if k < 3:
+                value = np.where(index > k, small[:, k], value)
+            if k > 0:
+                value = np.where(index < k, small[:, k - 1], value)
+            poses[:, 3 + k] = value
+
+        self.sequence = sequence
+        self.poses = poses
+        return poses